@@ -0,0 +1,32 @@
+/**
+ * Mode overlay. The start screen, the highscore list, a game and the name
+ * entry after it never run at the same time, so their scratch buffers
+ * share one region. Play is the only mode with much scratch, the
+ * animation plane and the animation, so the RAM this saves is the name
+ * entry state laid over it. What it buys beyond that is that a mode owns
+ * its buffers only until the next one claims the region with arena_enter,
+ * which clears it, so nothing is left over from the mode before: an
+ * animation that was playing when the game ended is simply gone.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>   // Enable use of uintX_t
+#include "gamedata.h" // Enable access to the well size
+#include "arena.h"    // Link with arena header file
+
+// A negative array size, so arena.c fails to compile if a mode outgrows ARENA_BYTES
+typedef char arena_budget[sizeof(union arena) == ARENA_BYTES ? 1 : -1];
+
+union arena arena;
+
+/**
+ * Hands the arena to mode, cleared. The mode only names the caller,
+ * clearing is the same for all of them
+ */
+void arena_enter(uint8_t mode)
+{
+    uint16_t i;
+
+    (void)mode;
+    for (i = 0; i < ARENA_BYTES / 4; i++)
+        arena.words[i] = 0;
+}
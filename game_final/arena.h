@@ -0,0 +1,65 @@
+/**
+ * Header file for arena.c
+ * One region of RAM the game modes take turns using for their scratch buffers,
+ * include gamedata.h first for the size of the animation plane
+ */
+
+#define ARENA_TITLE 0      // start screen
+#define ARENA_HIGHSCORES 1 // highscore list
+#define ARENA_PLAY 2       // a game is played
+#define ARENA_NAME 3       // a name is entered for a new highscore
+
+#define ARENA_BYTES 416 // the largest plane and its animation, arena.c does not compile if a mode needs more
+
+/**
+ * State of the animation currently playing.
+ * The game moves the figure or removes rows right away and the animation
+ * catches up, one frame per call to animation_tick.
+ * @author Olle Jernström
+ */
+struct animation
+{
+    uint8_t active;             // whether the animation owns the playing field
+    uint8_t frame;              // frames shown so far
+    uint8_t top, bot, lft, rgt; // block rectangle that moves, or rows that flash
+    uint8_t a;                  // 0 down, 1 right, 2 left, 3 clear
+    uint8_t frames;             // frames it takes, the last one is the playing field
+    well_rows rows;             // rows that flash in the clear animation
+    struct game_state *game;    // game whose playing field the last frame renders
+};
+
+/**
+ * Play mode, the animation plane and the animation playing on it. The
+ * plane has one 32-bit word per pixel row with bit x holding pixel
+ * column x, so byte c of a row is the byte page c of the display shows.
+ * Another mode claiming the arena clears active and so ends the animation.
+ */
+struct arena_play
+{
+    uint32_t anim[WELL_PIXELS];
+    struct animation animation;
+};
+
+/**
+ * Name entry, the letters picked so far and which one is being picked
+ */
+struct arena_name
+{
+    uint8_t letters[4];
+    uint8_t selected;
+};
+
+/**
+ * Only the member of the mode that called arena_enter last holds anything,
+ * the title screen and highscore list need no scratch at all
+ */
+union arena
+{
+    struct arena_play play;
+    struct arena_name name;
+    uint32_t words[ARENA_BYTES / 4]; // the budget, a mode that needs more makes the union larger
+};
+
+extern union arena arena;
+
+void arena_enter(uint8_t mode);
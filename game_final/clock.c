@@ -0,0 +1,95 @@
+/**
+ * Time keeping. Timer 2 and timer 3 interrupts count monotonic ticks,
+ * so the game can tell how many periods passed while it was busy
+ * instead of seeing at most one flag.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable use of chipkit specific macros
+#include "isr.h"     // Enable access to the core timer
+#include "clock.h"   // Link with clock header file
+
+volatile uint32_t clock_ticks;  // timer 2 periods since clock_init
+volatile uint32_t clock_frames; // timer 3 periods since clock_init
+
+/* Core timer count and microseconds at the last tick, the core timer
+   wraps every 107 seconds so the microsecond clock is extended from here */
+static volatile uint32_t base_count;
+static volatile uint32_t base_us;
+
+/**
+ * Starts timer 2 for game ticks and timer 3 for animation frames
+ */
+void clock_init(void)
+{
+    base_count = read_core_timer();
+    base_us = 0;
+
+    TMR2 = 0;                                 // make sure timer starts at 0
+    PR2 = 80000000 / 256 / CLOCK_TICK_HZ;     // 80MHz / desired frequency / 256 (prescale)
+    T2CONSET = 0x70;                          // Set prescale to 256
+
+    TMR3 = 0;
+    PR3 = 80000000 / 256 / CLOCK_FRAME_HZ;
+    T3CONSET = 0x70;
+
+    IPCCLR(2) = 0x1F; // timer 2 priority 2
+    IPCSET(2) = 2 << 2;
+    IPCCLR(3) = 0x1F; // timer 3 priority 2
+    IPCSET(3) = 2 << 2;
+    IFSCLR(0) = T2_IRQ | T3_IRQ;
+    IECSET(0) = T2_IRQ | T3_IRQ;
+
+    T2CONSET = 0x8000; // enable timer 2
+    T3CONSET = 0x8000; // enable timer 3
+}
+
+/**
+ * Timer 2 interrupt, one game tick
+ */
+void clock_service_tick(void)
+{
+    uint32_t now = read_core_timer();
+
+    IFSCLR(0) = T2_IRQ;
+    base_us += (now - base_count) / CORE_TICKS_PER_US;
+    base_count = now - (now - base_count) % CORE_TICKS_PER_US; // keep the remainder for the next tick
+    clock_ticks++;
+}
+
+/**
+ * Timer 3 interrupt, one animation frame
+ */
+void clock_service_frame(void)
+{
+    IFSCLR(0) = T3_IRQ;
+    clock_frames++;
+}
+
+/**
+ * Microseconds since clock_init, wraps after about 71 minutes
+ */
+uint32_t clock_us(void)
+{
+    uint32_t tick, count, us;
+
+    do
+    { // read base_count and base_us from the same tick
+        tick = clock_ticks;
+        count = base_count;
+        us = base_us;
+    } while (tick != clock_ticks);
+
+    return us + (read_core_timer() - count) / CORE_TICKS_PER_US;
+}
+
+/**
+ * Waits at least us microseconds, measured with the core timer
+ * so it does not depend on how the loop is compiled
+ */
+void delay_us(uint32_t us)
+{
+    uint32_t start = read_core_timer();
+    while (read_core_timer() - start < us * CORE_TICKS_PER_US)
+        ;
+}
@@ -0,0 +1,21 @@
+/**
+ * Header file for clock.c
+ * Timer interrupts counting game ticks and animation frames, and a
+ * microsecond clock on the core timer
+ */
+
+#define T2_IRQ (1 << 8)  // timer 2 flag in IFS(0)/IEC(0)
+#define T3_IRQ (1 << 12) // timer 3 flag in IFS(0)/IEC(0)
+
+#define CLOCK_TICK_HZ 10    // clock_ticks per second, paces the game
+#define CLOCK_FRAME_HZ 250  // clock_frames per second, paces animations
+#define CORE_TICKS_PER_US 40 // the core timer counts at half the 80 MHz system clock
+
+extern volatile uint32_t clock_ticks;
+extern volatile uint32_t clock_frames;
+
+void clock_init(void);
+void clock_service_tick(void);
+void clock_service_frame(void);
+uint32_t clock_us(void);
+void delay_us(uint32_t us);
@@ -6,6 +6,10 @@
 #include <stdint.h>
 #include <pic32mx.h>
 #include "display.h"
+#include "spi.h"
+#include "clock.h"
+#include "isr.h"
+#include "report.h"
 
 #define DISPLAY_CHANGE_TO_COMMAND_MODE (PORTFCLR = 0x10)
 #define DISPLAY_ACTIVATE_RESET (PORTGCLR = 0x200)
@@ -13,29 +17,143 @@
 #define DISPLAY_ACTIVATE_VDD (PORTFCLR = 0x40)
 #define DISPLAY_ACTIVATE_VBAT (PORTFCLR = 0x20)
 
-/* sleep:
-   A simple function to create a small delay.
-   Very inefficient use of computing resources,
-   but very handy in some special cases. */
-void sleep(int cyc)
+#define DISPLAY_RUN_GAP 6 // clean bytes cheaper to resend than to open a new window for
+
+/* display_buffer:
+   Shadow of the panel contents, one byte per page column.
+   Render functions draw into it and display_present sends the changes. */
+uint8_t display_buffer[DISPLAY_PAGES][DISPLAY_COLUMNS];
+
+/* One bit per display_buffer byte that differs from what the panel shows */
+static uint8_t dirty[DISPLAY_PAGES][DISPLAY_COLUMNS / 8];
+
+static uint8_t cursor_page, cursor_column; // where display_write puts its next byte
+
+#ifdef DISPLAY_STATS
+/* display_stats:
+   SPI traffic by game phase and by the render function that caused it.
+   Only in debug builds, the counting costs a few core timer reads per
+   queued segment. */
+struct display_stats display_stats[DISPLAY_PHASES][DISPLAY_SOURCES];
+
+static uint8_t stats_source, stats_phase;
+static uint8_t stats_dc;                        // D/C level of the last byte counted
+static uint32_t stats_ticks[DISPLAY_PHASES];    // clock_ticks spent in each phase before the current stretch
+static uint32_t stats_since;                    // clock_ticks when the current phase was entered
+
+static const char *const source_names[DISPLAY_SOURCES] = {"display", "screens", "highscores", "field", "panel", "animation"};
+static const char *const phase_names[DISPLAY_PHASES] = {"title", "highscores", "play", "name"};
+
+/* stats_count:
+   Counts one transaction of len bytes and the core timer ticks it took. */
+static void stats_count(uint16_t len, uint8_t dc, uint32_t ticks)
 {
-    int i;
-    for (i = cyc; i > 0; i--)
-        ;
+    struct display_stats *s = &display_stats[stats_phase][stats_source];
+
+    s->bytes += len;
+    s->transactions++;
+    s->wait_ticks += ticks;
+    if (dc != stats_dc)
+        s->dc_toggles++;
+    stats_dc = dc;
+}
+
+/* display_stats_source:
+   Names the render function the traffic from now on belongs to. */
+void display_stats_source(uint8_t source)
+{
+    stats_source = source;
+}
+
+/* display_stats_phase:
+   Switches the game phase the traffic from now on belongs to. */
+void display_stats_phase(uint8_t phase)
+{
+    uint32_t now = clock_ticks;
+
+    stats_ticks[stats_phase] += now - stats_since;
+    stats_since = now;
+    stats_phase = phase;
+}
+
+/* display_stats_clear:
+   Starts counting over, in the phase the game is in. */
+void display_stats_clear(void)
+{
+    uint8_t p, s;
+
+    for (p = 0; p < DISPLAY_PHASES; p++)
+    {
+        stats_ticks[p] = 0;
+        for (s = 0; s < DISPLAY_SOURCES; s++)
+            display_stats[p][s].bytes = display_stats[p][s].transactions =
+                display_stats[p][s].dc_toggles = display_stats[p][s].wait_ticks = 0;
+    }
+    stats_since = clock_ticks;
+}
+
+/* stats_rate:
+   n per game second over ticks clock_ticks, without 64 bit division. */
+static uint32_t stats_rate(uint32_t n, uint32_t ticks)
+{
+    if (n < 0xFFFFFFFF / CLOCK_TICK_HZ)
+        return n * CLOCK_TICK_HZ / ticks;
+    return n / ticks * CLOCK_TICK_HZ;
 }
 
+/* display_stats_report:
+   Hands the table to line one text line at a time, every counter as a
+   rate per game second of the phase it was counted in, plus the total
+   bytes. Callable at any time, the current phase is counted up to now. */
+void display_stats_report(void (*line)(const char *text))
+{
+    char text[80], *t;
+    uint8_t p, s;
+    uint32_t ticks;
+    struct display_stats *st;
+
+    line("phase      source       bytes/s   trans/s    dc/s   wait us/s   bytes");
+    for (p = 0; p < DISPLAY_PHASES; p++)
+    {
+        ticks = stats_ticks[p] + (p == stats_phase ? clock_ticks - stats_since : 0);
+        if (!ticks)
+            continue;
+        for (s = 0; s < DISPLAY_SOURCES; s++)
+        {
+            st = &display_stats[p][s];
+            if (!st->transactions)
+                continue;
+            t = report_field(text, phase_names[p], 0, 10);
+            t = report_field(t, source_names[s], 0, 11);
+            t = report_field(t, 0, stats_rate(st->bytes, ticks), 12);
+            t = report_field(t, 0, stats_rate(st->transactions, ticks), 10);
+            t = report_field(t, 0, stats_rate(st->dc_toggles, ticks), 8);
+            t = report_field(t, 0, stats_rate(st->wait_ticks / CORE_TICKS_PER_US, ticks), 12);
+            t = report_field(t, 0, st->bytes, 8);
+            *t = 0;
+            line(text);
+        }
+    }
+}
+#endif
+
+/* display_init:
+   Cold power up sequence for the panel, only needed once after reset.
+   Delays are the minimums from the SSD1306 power up sequence. */
 void display_init(void)
 {
+    display_stats_source(DISPLAY_SOURCE_DISPLAY);
+    spi_wait(); // the queued transfer owns SPI2 until it is done
     DISPLAY_CHANGE_TO_COMMAND_MODE;
-    sleep(10);
+    delay_us(1);
     DISPLAY_ACTIVATE_VDD;
-    sleep(1000000);
+    delay_us(1000); // VDD settles
 
     spi_send_recv(0xAE);
     DISPLAY_ACTIVATE_RESET;
-    sleep(10);
+    delay_us(3); // reset pulse
     DISPLAY_DO_NOT_RESET;
-    sleep(10);
+    delay_us(3);
 
     spi_send_recv(0x8D);
     spi_send_recv(0x14);
@@ -44,7 +162,7 @@ void display_init(void)
     spi_send_recv(0xF1);
 
     DISPLAY_ACTIVATE_VBAT;
-    sleep(10000000);
+    delay_us(100000); // VBAT settles before the panel is switched on
 
     spi_send_recv(0xA1);
     spi_send_recv(0xC8);
@@ -52,15 +170,157 @@ void display_init(void)
     spi_send_recv(0xDA);
     spi_send_recv(0x20);
 
+    spi_send_recv(0x20); // horizontal addressing, needed for column/page windows
+    spi_send_recv(0x00);
+
     spi_send_recv(0xAF);
+
+    display_invalidate(); // panel contents are unknown after power up
+}
+
+/* display_warm_restart:
+   Blanks the already powered panel in a single queued burst, used instead
+   of display_init every time the game goes back to the title screen. */
+void display_warm_restart(void)
+{
+    uint8_t p, c;
+    display_stats_source(DISPLAY_SOURCE_DISPLAY);
+    for (p = 0; p < DISPLAY_PAGES; p++)
+        for (c = 0; c < DISPLAY_COLUMNS; c++)
+            display_buffer[p][c] = 0;
+    display_present_window(0, DISPLAY_PAGES - 1, 0, DISPLAY_COLUMNS - 1);
 }
 
 uint8_t spi_send_recv(uint8_t data)
 {
+#ifdef DISPLAY_STATS
+    uint32_t start = read_core_timer();
+#endif
     while (!(SPI2STAT & 0x08))
         ;
     SPI2BUF = data;
     while (!(SPI2STAT & 1))
         ;
+#ifdef DISPLAY_STATS
+    stats_count(1, SPI_COMMAND, read_core_timer() - start); // only used for commands
+#endif
     return SPI2BUF;
 }
+
+/* display_send:
+   Queues bytes for the SPI engine, counting them in debug builds. */
+static void display_send(const uint8_t *data, uint16_t len, uint8_t dc)
+{
+#ifdef DISPLAY_STATS
+    uint32_t start = read_core_timer();
+    spi_queue(data, len, dc);
+    stats_count(len, dc, read_core_timer() - start); // spi_queue only waits when its ring is full
+#else
+    spi_queue(data, len, dc);
+#endif
+}
+
+/* display_set_window:
+   Queues the commands limiting the panel write position to columns
+   first..last of pages first_page..last_page. */
+static void display_set_window(uint8_t first_page, uint8_t last_page, uint8_t first, uint8_t last)
+{
+    uint8_t cmd[6];
+
+    cmd[0] = 0x21;
+    cmd[1] = first;
+    cmd[2] = last;
+    cmd[3] = 0x22;
+    cmd[4] = first_page;
+    cmd[5] = last_page;
+    display_send(cmd, 6, SPI_COMMAND);
+}
+
+/* display_set_cursor:
+   Moves the framebuffer write position, wrapping like the panel's
+   page addressing does. */
+void display_set_cursor(uint8_t page, uint8_t column)
+{
+    cursor_page = page & (DISPLAY_PAGES - 1);
+    cursor_column = column & (DISPLAY_COLUMNS - 1);
+}
+
+/* display_write:
+   Stores one byte in the framebuffer and marks it dirty if it changed. */
+void display_write(uint8_t data)
+{
+    uint8_t *b = &display_buffer[cursor_page][cursor_column];
+
+    if (*b != data)
+    {
+        *b = data;
+        dirty[cursor_page][cursor_column >> 3] |= 1 << (cursor_column & 7);
+    }
+    cursor_column = (cursor_column + 1) & (DISPLAY_COLUMNS - 1);
+}
+
+/* display_invalidate:
+   Forces the next display_present to resend the whole framebuffer. */
+void display_invalidate(void)
+{
+    uint8_t p, i;
+    for (p = 0; p < DISPLAY_PAGES; p++)
+        for (i = 0; i < DISPLAY_COLUMNS / 8; i++)
+            dirty[p][i] = 0xFF;
+}
+
+/* display_present:
+   Queues the dirty runs of the framebuffer for the SPI engine. Runs separated
+   by fewer clean bytes than a window command costs are merged into one.
+   Returns immediately, spi_ticket/spi_done tell when the frame is out. */
+void display_present(void)
+{
+    uint8_t p, c, first, last;
+
+    for (p = 0; p < DISPLAY_PAGES; p++)
+    {
+        c = 0;
+        while (c < DISPLAY_COLUMNS)
+        {
+            if (!dirty[p][c >> 3])
+            { // skip 8 clean bytes at a time
+                c = (c | 7) + 1;
+                continue;
+            }
+            if (!(dirty[p][c >> 3] & (1 << (c & 7))))
+            {
+                c++;
+                continue;
+            }
+
+            first = last = c;
+            while (++c < DISPLAY_COLUMNS && c - last <= DISPLAY_RUN_GAP)
+                if (dirty[p][c >> 3] & (1 << (c & 7)))
+                    last = c;
+
+            display_set_window(p, p, first, last);
+            display_send(&display_buffer[p][first], last - first + 1, SPI_DATA);
+            c = last + 1;
+        }
+
+        for (c = 0; c < DISPLAY_COLUMNS / 8; c++)
+            dirty[p][c] = 0;
+    }
+}
+
+/* display_present_window:
+   Sends one rectangle of the framebuffer, columns first..last of pages
+   first_page..last_page, behind a single window command. Used when the
+   caller knows exactly where the screen changed. */
+void display_present_window(uint8_t first_page, uint8_t last_page, uint8_t first, uint8_t last)
+{
+    uint8_t p, c;
+
+    display_set_window(first_page, last_page, first, last);
+    for (p = first_page; p <= last_page; p++)
+    {
+        display_send(&display_buffer[p][first], last - first + 1, SPI_DATA);
+        for (c = first; c <= last; c++)
+            dirty[p][c >> 3] &= ~(1 << (c & 7));
+    }
+}
@@ -5,6 +5,54 @@
  * For copyright and licensing, see file COPYING
  */
 
+#define DISPLAY_PAGES 4      // 8 pixel high pages on the SSD1306
+#define DISPLAY_COLUMNS 128  // columns per page
+
+extern uint8_t display_buffer[DISPLAY_PAGES][DISPLAY_COLUMNS];
+
 void display_init(void);
+void display_warm_restart(void);
 uint8_t spi_send_recv(uint8_t data);
-void sleep(int cyc);
+void display_set_cursor(uint8_t page, uint8_t column);
+void display_write(uint8_t data);
+void display_invalidate(void);
+void display_present(void);
+void display_present_window(uint8_t first_page, uint8_t last_page, uint8_t first, uint8_t last);
+
+/* Where display traffic is counted when built with -DDISPLAY_STATS:
+   the render function that queued it and the game phase it was in.
+   The host build prints the report when its run ends, the board sends
+   it at game over when also built with -DTELEMETRY, see report.c */
+#define DISPLAY_SOURCE_DISPLAY 0    // power up and blanking
+#define DISPLAY_SOURCE_SCREENS 1    // start screen and name selection
+#define DISPLAY_SOURCE_HIGHSCORES 2 // render_highscores
+#define DISPLAY_SOURCE_FIELD 3      // render_playing_field
+#define DISPLAY_SOURCE_PANEL 4      // render_scores_and_next_figure
+#define DISPLAY_SOURCE_ANIMATION 5  // render_animation
+#define DISPLAY_SOURCES 6
+
+#define DISPLAY_PHASE_TITLE 0      // start screen
+#define DISPLAY_PHASE_HIGHSCORES 1 // highscore list
+#define DISPLAY_PHASE_PLAY 2       // playing
+#define DISPLAY_PHASE_NAME 3       // game over and name entry
+#define DISPLAY_PHASES 4
+
+#ifdef DISPLAY_STATS
+struct display_stats
+{
+    uint32_t bytes;        // bytes sent, commands and data
+    uint32_t transactions; // window commands, data runs and single command bytes
+    uint32_t dc_toggles;   // times the D/C line changes level
+    uint32_t wait_ticks;   // core timer ticks spent handing bytes to SPI2, waiting for room in its queue included
+};
+
+extern struct display_stats display_stats[DISPLAY_PHASES][DISPLAY_SOURCES];
+
+void display_stats_source(uint8_t source);
+void display_stats_phase(uint8_t phase);
+void display_stats_clear(void);
+void display_stats_report(void (*line)(const char *text));
+#else
+#define display_stats_source(source) ((void)0)
+#define display_stats_phase(phase) ((void)0)
+#endif
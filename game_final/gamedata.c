@@ -2,78 +2,54 @@
 #include "gamedata.h" 	// Link with gamedata header file
 
 /**
-  * 2D-array containing score & highscore with text for top rendering
-  * @author Marcus Bardvall
+  * Every figure in all 4 rotations, in the order I J L O S T Z.
+  * Rotating or spawning a figure only changes which entry is used.
   */
-uint8_t scores[19][8] = {
-	{5, 2, 14, 14, 14, 14, 14, 14},
-	{5, 10, 10, 10, 10, 10, 10, 10},
-	{5, 10, 10, 10, 10, 10, 10, 10},
-	{5, 2, 10, 10, 10, 10, 10, 10},
-	{7, 2, 10, 10, 10, 10, 10, 10},
-	{5, 2, 10, 10, 10, 10, 10, 10},
-	{5, 10, 10, 10, 10, 10, 10, 10},
-	{5, 10, 10, 10, 10, 10, 10, 10},
-	{5, 2, 14, 14, 14, 14, 14, 14},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{7, 3, 14, 14, 14, 14, 14, 14},
-	{5, 9, 10, 10, 10, 10, 10, 10},
-	{1, 9, 10, 10, 10, 10, 10, 10},
-	{1, 1, 10, 10, 10, 10, 10, 10},
-	{7, 1, 10, 10, 10, 10, 10, 10},
-	{4, 1, 10, 10, 10, 10, 10, 10},
-	{4, 9, 10, 10, 10, 10, 10, 10},
-	{5, 9, 10, 10, 10, 10, 10, 10},
-	{7, 3, 14, 14, 14, 14, 14, 14}
+const struct shape shapes[7][4] = {
+	{{0x000F, 4, 1, 0x0000}, {0x1111, 1, 4, 0x0003}, {0x000F, 4, 1, 0x0000}, {0x1111, 1, 4, 0x0003}},
+	{{0x0071, 3, 2, 0x0111}, {0x0113, 2, 3, 0x0002}, {0x0047, 3, 2, 0x0100}, {0x0322, 2, 3, 0x0022}},
+	{{0x0074, 3, 2, 0x0111}, {0x0311, 2, 3, 0x0022}, {0x0017, 3, 2, 0x0001}, {0x0223, 2, 3, 0x0020}},
+	{{0x0033, 2, 2, 0x0011}, {0x0033, 2, 2, 0x0011}, {0x0033, 2, 2, 0x0011}, {0x0033, 2, 2, 0x0011}},
+	{{0x0036, 3, 2, 0x0011}, {0x0231, 2, 3, 0x0021}, {0x0036, 3, 2, 0x0011}, {0x0231, 2, 3, 0x0021}},
+	{{0x0027, 3, 2, 0x0010}, {0x0232, 2, 3, 0x0021}, {0x0072, 3, 2, 0x0111}, {0x0131, 2, 3, 0x0012}},
+	{{0x0063, 3, 2, 0x0110}, {0x0132, 2, 3, 0x0012}, {0x0063, 3, 2, 0x0110}, {0x0132, 2, 3, 0x0012}}
 };
 
 /**
-  * 2D-array containing current figure
-  * @author Marcus Bardvall
+  * Kicks tried in order when rotating each figure clockwise out of each
+  * rotation. These are the guideline (SRS) wall kicks with rows counted
+  * downwards, plus the move of the shape box within the guideline
+  * rotation box, so a figure turns about the same center as in guideline
+  * play although its position is kept as the top left of its own box.
   */
-uint8_t current[4][4] = {
-	{0, 0, 0, 0},
-	{0, 0, 0, 0},
-	{0, 0, 0, 0},
-	{0, 0, 0, 0}
+const struct kick kicks[7][4][KICK_TESTS] = {
+	{{{2, -1}, {0, -1}, {3, -1}, {0, 0}, {3, -3}},
+	 {{-2, 2}, {-3, 2}, {0, 2}, {-3, 0}, {0, 3}},
+	 {{1, -2}, {3, -2}, {0, -2}, {3, -3}, {0, 0}},
+	 {{-1, 1}, {0, 1}, {-3, 1}, {0, 3}, {-3, 0}}}, // I
+	{{{1, 0}, {0, 0}, {0, -1}, {1, 2}, {0, 2}},
+	 {{-1, 1}, {0, 1}, {0, 2}, {-1, -1}, {0, -1}},
+	 {{0, -1}, {1, -1}, {1, -2}, {0, 1}, {1, 1}},
+	 {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}, // J
+	{{{1, 0}, {0, 0}, {0, -1}, {1, 2}, {0, 2}},
+	 {{-1, 1}, {0, 1}, {0, 2}, {-1, -1}, {0, -1}},
+	 {{0, -1}, {1, -1}, {1, -2}, {0, 1}, {1, 1}},
+	 {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}, // L
+	{{{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}},
+	 {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}},
+	 {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}},
+	 {{0, 0}, {0, 0}, {0, 0}, {0, 0}, {0, 0}}}, // O
+	{{{1, 0}, {0, 0}, {0, -1}, {1, 2}, {0, 2}},
+	 {{-1, 1}, {0, 1}, {0, 2}, {-1, -1}, {0, -1}},
+	 {{0, -1}, {1, -1}, {1, -2}, {0, 1}, {1, 1}},
+	 {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}}, // S
+	{{{0, -1}, {1, -1}, {1, -2}, {0, 1}, {1, 1}},
+	 {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}},
+	 {{1, 0}, {0, 0}, {0, -1}, {1, 2}, {0, 2}},
+	 {{-1, 1}, {0, 1}, {0, 2}, {-1, -1}, {0, -1}}}, // T
+	{{{1, 0}, {0, 0}, {0, -1}, {1, 2}, {0, 2}},
+	 {{-1, 1}, {0, 1}, {0, 2}, {-1, -1}, {0, -1}},
+	 {{0, -1}, {1, -1}, {1, -2}, {0, 1}, {1, 1}},
+	 {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}}} // Z
 };
 
-/**
-  * 2D-array containing next figure
-  * @author Marcus Bardvall
-  */
-uint8_t next[2][4] = {
-	{0, 0, 0, 0},
-	{0, 0, 0, 0}
-};
-
-/**
-  * 2D-array containing entire play field
-  * @author Marcus Bardvall
-  */
-uint8_t field[24][8] = {
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-	{0, 0, 0, 0, 0, 0, 0, 0},
-};
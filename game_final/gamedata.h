@@ -2,8 +2,117 @@
   * Header file for gamedata
   * @author Marucs Bardvall
 */
+#include "random.h" // Enable use of the figure generator state
 
-extern uint8_t scores[19][8];
-extern uint8_t current[4][4];
-extern uint8_t next[2][4];
-extern uint8_t field[24][8];
+/**
+  * Size of the well in cells and of a cell in pixels, build with for example
+  * -DWELL_WIDTH=10 -DWELL_HEIGHT=20 -DWELL_CELL=3 for a standard well.
+  * The well is drawn in the 32 pixel wide and 96 pixel high part of the
+  * display below the side panel, right under the panel and centered
+  * horizontally, with walls and a floor in the pixels it leaves free.
+  */
+#ifndef WELL_WIDTH
+#define WELL_WIDTH 8 // columns
+#endif
+#ifndef WELL_HEIGHT
+#define WELL_HEIGHT 24 // rows
+#endif
+#ifndef WELL_CELL
+#define WELL_CELL 4 // pixels per side of a cell
+#endif
+
+#if WELL_CELL < 2 || WELL_CELL > 4
+#error "WELL_CELL must be 2, 3 or 4"
+#endif
+#if WELL_WIDTH < 4 || WELL_WIDTH > 16 || WELL_WIDTH * WELL_CELL > 32
+#error "the well must be 4 to 16 columns and at most 32 pixels wide"
+#endif
+#if WELL_HEIGHT < 4 || WELL_HEIGHT > 64 || WELL_HEIGHT * WELL_CELL > 96
+#error "the well must be 4 to 64 rows and at most 96 pixels high"
+#endif
+
+#define WELL_PIXELS (WELL_HEIGHT * WELL_CELL)       // pixel rows the well takes
+#define WELL_LEFT ((32 - WELL_WIDTH * WELL_CELL) / 2) // pixel column of the left edge of column 0
+#define WELL_FULL ((well_row)((1UL << WELL_WIDTH) - 1)) // a row with every column filled
+
+#if WELL_WIDTH <= 8
+typedef uint8_t well_row; // bit j is column j
+#else
+typedef uint16_t well_row;
+#endif
+
+#if WELL_HEIGHT <= 32
+typedef uint32_t well_rows; // bit r is row r
+#else
+typedef uint64_t well_rows;
+#endif
+
+/**
+  * One rotation of a figure: 4 rows of 4 cells, the top row in bits 0-3
+  * and the leftmost cell of a row in its lowest bit, its box size and
+  * the bottom cell of each of its columns
+  */
+struct shape
+{
+	uint16_t mask;
+	uint8_t w, h;
+	uint16_t bottom; // 4 bits per column, the leftmost column in bits 0-3
+};
+
+#define SHAPE_ROW(mask, i) (((mask) >> ((i) * 4)) & 0xF)       // cells of row i of a shape
+#define SHAPE_BOTTOM(bottom, j) (((bottom) >> ((j) * 4)) & 0xF) // row of the bottom cell of column j
+
+extern const struct shape shapes[7][4];
+
+/**
+  * Offset a rotated figure is moved by when it does not fit in place
+  */
+struct kick
+{
+	int8_t x, y;
+};
+
+#define KICK_TESTS 5 // kicks tried per rotation
+
+extern const struct kick kicks[7][4][KICK_TESTS];
+
+/**
+  * Everything one game is made of. The logic only ever works on the game it
+  * is handed, so several games can run side by side and a whole game can be
+  * copied or saved with a single memcpy.
+  */
+struct game_state
+{
+	well_row field[WELL_HEIGHT];	  // row masks, bit j is column j
+	well_row ghost[WELL_HEIGHT];	  // where the figure would land, same layout as field
+	uint8_t column_top[WELL_WIDTH]; // highest block of each column, WELL_HEIGHT if empty
+	well_rows completed_rows;		  // bit r is set if row r is full
+
+	uint8_t figure_type;		  // index into shapes
+	uint8_t next_figure_type;	  // index into shapes of the next figure
+	uint8_t rotation;			  // index into shapes[figure_type]
+	uint8_t pos_x, pos_y, offset; // box size and spawn column of the current figure
+	int8_t move_x;				  // columns moved from the spawn column
+	uint8_t move_y;				  // row of the top of the box
+	uint8_t ghost_on;			  // whether the ghost is shown
+	uint8_t ghost_y, ghost_h;	  // rows the ghost covers
+
+	uint32_t current_score;
+	uint32_t high_score;
+	int8_t highscore_to_beat;	// index of the highscore the player currently attempts to beat
+	uint8_t score_digits[2][6]; // digits of high_score (row 0) and current_score (row 1), most significant first
+	uint16_t panel_dirty;		// PANEL_DIRTY bits for the parts of the side panel that have to be redrawn
+
+	uint8_t time_out_counter;		// game ticks since the figure last fell
+	uint8_t time_out_value;			// game ticks between falls
+	uint8_t speed_increase_counter; // falls since the game last sped up
+	uint8_t speed_increase_value;	// falls between speed ups
+
+	struct random_state random; // figure sequence
+};
+
+#define PANEL_DIGIT(l, d) (1 << ((l) * 6 + (d))) // dirty bit of digit d of highscore (l = 0) or score (l = 1)
+#define PANEL_DIRTY_DIGITS 0x0FFF                // every digit
+#define PANEL_DIRTY_NEXT 0x1000                  // next figure preview
+#define PANEL_DIRTY_FRAME 0x2000                 // borders and text
+#define PANEL_DIRTY_ALL 0x3FFF                   // the whole side panel
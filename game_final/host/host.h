@@ -0,0 +1,19 @@
+/**
+ * Header file for host/runtime.c
+ * What a host test can use beyond the register stand-in
+ */
+
+/* Pins of host_pin, in the order of their names in a script */
+#define HOST_BTN1 0
+#define HOST_BTN2 1
+#define HOST_BTN3 2
+#define HOST_BTN4 3
+#define HOST_SW1 4
+#define HOST_SW4 5
+
+extern void (*host_spi_trace)(uint8_t byte, uint8_t dc);
+
+void host_start(double seconds);
+uint8_t host_pin(double ms, uint8_t pin, uint8_t level);
+uint8_t host_panel(uint8_t page, uint8_t column);
+uint8_t host_in_isr(void);
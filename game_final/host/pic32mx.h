@@ -0,0 +1,261 @@
+/**
+ * Stand-in for the pic32mx.h of the mcb32 toolchain, used by the host
+ * build. Every register is a word of the runtime in host/runtime.c and
+ * every access goes through host_sfr, which first lets the emulated
+ * timers, SPI2 and buttons catch up with the virtual clock and takes
+ * any interrupt that became due. SET, CLR and INV writes behave like on
+ * the chip, as do reads and writes of SPI2BUF.
+ * Only the registers the game uses are here.
+ * For copyright and licensing, see file COPYING
+ */
+#ifndef HOST_PIC32MX_H
+#define HOST_PIC32MX_H
+
+#include <stdint.h> // Enable use of uintX_t
+
+enum host_register
+{
+    HOST_OSCCON, // oscillator control
+    HOST_SYSKEY, // unlock key, writes are ignored
+    HOST_AD1PCFG, // analog pin select
+    HOST_INTCON, // interrupt control, bit 4 is the INT4 edge
+    HOST_IFS0,
+    HOST_IFS1,
+    HOST_IFS2,
+    HOST_IEC0,
+    HOST_IEC1,
+    HOST_IEC2,
+    HOST_IPC0,
+    HOST_IPC1,
+    HOST_IPC2,
+    HOST_IPC3,
+    HOST_IPC4,
+    HOST_IPC5,
+    HOST_IPC6,
+    HOST_IPC7,
+    HOST_IPC8,
+    HOST_IPC9,
+    HOST_IPC10,
+    HOST_IPC11,
+    HOST_IPC12,
+    HOST_T2CON,
+    HOST_TMR2,
+    HOST_PR2,
+    HOST_T3CON,
+    HOST_TMR3,
+    HOST_PR3,
+    HOST_SPI2CON,
+    HOST_SPI2STAT,
+    HOST_SPI2BUF,
+    HOST_SPI2BRG,
+    HOST_U1MODE,
+    HOST_U1STA, // bit 9 is set while the transmit FIFO is full
+    HOST_U1TXREG,
+    HOST_U1RXREG,
+    HOST_U1BRG,
+    HOST_CNCON,
+    HOST_CNEN,
+    HOST_TRISD,
+    HOST_PORTD, // buttons 2-4 on RD5-7, switch 1 on RD8, switch 4 on RD11
+    HOST_ODCD,
+    HOST_TRISE,
+    HOST_PORTE,
+    HOST_ODCE,
+    HOST_TRISF,
+    HOST_PORTF, // button 1 on RF1, display D/C on RF4
+    HOST_ODCF,
+    HOST_TRISG,
+    HOST_PORTG,
+    HOST_ODCG,
+    HOST_REGISTERS
+};
+
+#define HOST_BASE 0 // plain read or write
+#define HOST_CLR 1  // writing 1 clears the bit
+#define HOST_SET 2  // writing 1 sets the bit
+#define HOST_INV 3  // writing 1 flips the bit
+
+volatile uint32_t *host_sfr(uint8_t reg, uint8_t op);
+
+#define HOST_SFR(reg, op) (*host_sfr(reg, op))
+
+#define OSCCON HOST_SFR(HOST_OSCCON, HOST_BASE)
+#define OSCCONCLR HOST_SFR(HOST_OSCCON, HOST_CLR)
+#define OSCCONSET HOST_SFR(HOST_OSCCON, HOST_SET)
+#define OSCCONINV HOST_SFR(HOST_OSCCON, HOST_INV)
+
+#define SYSKEY HOST_SFR(HOST_SYSKEY, HOST_BASE)
+#define SYSKEYCLR HOST_SFR(HOST_SYSKEY, HOST_CLR)
+#define SYSKEYSET HOST_SFR(HOST_SYSKEY, HOST_SET)
+#define SYSKEYINV HOST_SFR(HOST_SYSKEY, HOST_INV)
+
+#define AD1PCFG HOST_SFR(HOST_AD1PCFG, HOST_BASE)
+#define AD1PCFGCLR HOST_SFR(HOST_AD1PCFG, HOST_CLR)
+#define AD1PCFGSET HOST_SFR(HOST_AD1PCFG, HOST_SET)
+#define AD1PCFGINV HOST_SFR(HOST_AD1PCFG, HOST_INV)
+
+#define INTCON HOST_SFR(HOST_INTCON, HOST_BASE)
+#define INTCONCLR HOST_SFR(HOST_INTCON, HOST_CLR)
+#define INTCONSET HOST_SFR(HOST_INTCON, HOST_SET)
+#define INTCONINV HOST_SFR(HOST_INTCON, HOST_INV)
+
+#define T2CON HOST_SFR(HOST_T2CON, HOST_BASE)
+#define T2CONCLR HOST_SFR(HOST_T2CON, HOST_CLR)
+#define T2CONSET HOST_SFR(HOST_T2CON, HOST_SET)
+#define T2CONINV HOST_SFR(HOST_T2CON, HOST_INV)
+
+#define TMR2 HOST_SFR(HOST_TMR2, HOST_BASE)
+#define TMR2CLR HOST_SFR(HOST_TMR2, HOST_CLR)
+#define TMR2SET HOST_SFR(HOST_TMR2, HOST_SET)
+#define TMR2INV HOST_SFR(HOST_TMR2, HOST_INV)
+
+#define PR2 HOST_SFR(HOST_PR2, HOST_BASE)
+#define PR2CLR HOST_SFR(HOST_PR2, HOST_CLR)
+#define PR2SET HOST_SFR(HOST_PR2, HOST_SET)
+#define PR2INV HOST_SFR(HOST_PR2, HOST_INV)
+
+#define T3CON HOST_SFR(HOST_T3CON, HOST_BASE)
+#define T3CONCLR HOST_SFR(HOST_T3CON, HOST_CLR)
+#define T3CONSET HOST_SFR(HOST_T3CON, HOST_SET)
+#define T3CONINV HOST_SFR(HOST_T3CON, HOST_INV)
+
+#define TMR3 HOST_SFR(HOST_TMR3, HOST_BASE)
+#define TMR3CLR HOST_SFR(HOST_TMR3, HOST_CLR)
+#define TMR3SET HOST_SFR(HOST_TMR3, HOST_SET)
+#define TMR3INV HOST_SFR(HOST_TMR3, HOST_INV)
+
+#define PR3 HOST_SFR(HOST_PR3, HOST_BASE)
+#define PR3CLR HOST_SFR(HOST_PR3, HOST_CLR)
+#define PR3SET HOST_SFR(HOST_PR3, HOST_SET)
+#define PR3INV HOST_SFR(HOST_PR3, HOST_INV)
+
+#define SPI2CON HOST_SFR(HOST_SPI2CON, HOST_BASE)
+#define SPI2CONCLR HOST_SFR(HOST_SPI2CON, HOST_CLR)
+#define SPI2CONSET HOST_SFR(HOST_SPI2CON, HOST_SET)
+#define SPI2CONINV HOST_SFR(HOST_SPI2CON, HOST_INV)
+
+#define SPI2STAT HOST_SFR(HOST_SPI2STAT, HOST_BASE)
+#define SPI2STATCLR HOST_SFR(HOST_SPI2STAT, HOST_CLR)
+#define SPI2STATSET HOST_SFR(HOST_SPI2STAT, HOST_SET)
+#define SPI2STATINV HOST_SFR(HOST_SPI2STAT, HOST_INV)
+
+#define SPI2BUF HOST_SFR(HOST_SPI2BUF, HOST_BASE)
+#define SPI2BUFCLR HOST_SFR(HOST_SPI2BUF, HOST_CLR)
+#define SPI2BUFSET HOST_SFR(HOST_SPI2BUF, HOST_SET)
+#define SPI2BUFINV HOST_SFR(HOST_SPI2BUF, HOST_INV)
+
+#define SPI2BRG HOST_SFR(HOST_SPI2BRG, HOST_BASE)
+#define SPI2BRGCLR HOST_SFR(HOST_SPI2BRG, HOST_CLR)
+#define SPI2BRGSET HOST_SFR(HOST_SPI2BRG, HOST_SET)
+#define SPI2BRGINV HOST_SFR(HOST_SPI2BRG, HOST_INV)
+
+#define U1MODE HOST_SFR(HOST_U1MODE, HOST_BASE)
+#define U1MODECLR HOST_SFR(HOST_U1MODE, HOST_CLR)
+#define U1MODESET HOST_SFR(HOST_U1MODE, HOST_SET)
+#define U1MODEINV HOST_SFR(HOST_U1MODE, HOST_INV)
+
+#define U1STA HOST_SFR(HOST_U1STA, HOST_BASE)
+#define U1STACLR HOST_SFR(HOST_U1STA, HOST_CLR)
+#define U1STASET HOST_SFR(HOST_U1STA, HOST_SET)
+#define U1STAINV HOST_SFR(HOST_U1STA, HOST_INV)
+
+#define U1TXREG HOST_SFR(HOST_U1TXREG, HOST_BASE)
+#define U1TXREGCLR HOST_SFR(HOST_U1TXREG, HOST_CLR)
+#define U1TXREGSET HOST_SFR(HOST_U1TXREG, HOST_SET)
+#define U1TXREGINV HOST_SFR(HOST_U1TXREG, HOST_INV)
+
+#define U1RXREG HOST_SFR(HOST_U1RXREG, HOST_BASE)
+#define U1RXREGCLR HOST_SFR(HOST_U1RXREG, HOST_CLR)
+#define U1RXREGSET HOST_SFR(HOST_U1RXREG, HOST_SET)
+#define U1RXREGINV HOST_SFR(HOST_U1RXREG, HOST_INV)
+
+#define U1BRG HOST_SFR(HOST_U1BRG, HOST_BASE)
+#define U1BRGCLR HOST_SFR(HOST_U1BRG, HOST_CLR)
+#define U1BRGSET HOST_SFR(HOST_U1BRG, HOST_SET)
+#define U1BRGINV HOST_SFR(HOST_U1BRG, HOST_INV)
+
+#define CNCON HOST_SFR(HOST_CNCON, HOST_BASE)
+#define CNCONCLR HOST_SFR(HOST_CNCON, HOST_CLR)
+#define CNCONSET HOST_SFR(HOST_CNCON, HOST_SET)
+#define CNCONINV HOST_SFR(HOST_CNCON, HOST_INV)
+
+#define CNEN HOST_SFR(HOST_CNEN, HOST_BASE)
+#define CNENCLR HOST_SFR(HOST_CNEN, HOST_CLR)
+#define CNENSET HOST_SFR(HOST_CNEN, HOST_SET)
+#define CNENINV HOST_SFR(HOST_CNEN, HOST_INV)
+
+#define TRISD HOST_SFR(HOST_TRISD, HOST_BASE)
+#define TRISDCLR HOST_SFR(HOST_TRISD, HOST_CLR)
+#define TRISDSET HOST_SFR(HOST_TRISD, HOST_SET)
+#define TRISDINV HOST_SFR(HOST_TRISD, HOST_INV)
+
+#define PORTD HOST_SFR(HOST_PORTD, HOST_BASE)
+#define PORTDCLR HOST_SFR(HOST_PORTD, HOST_CLR)
+#define PORTDSET HOST_SFR(HOST_PORTD, HOST_SET)
+#define PORTDINV HOST_SFR(HOST_PORTD, HOST_INV)
+
+#define ODCD HOST_SFR(HOST_ODCD, HOST_BASE)
+#define ODCDCLR HOST_SFR(HOST_ODCD, HOST_CLR)
+#define ODCDSET HOST_SFR(HOST_ODCD, HOST_SET)
+#define ODCDINV HOST_SFR(HOST_ODCD, HOST_INV)
+
+#define TRISE HOST_SFR(HOST_TRISE, HOST_BASE)
+#define TRISECLR HOST_SFR(HOST_TRISE, HOST_CLR)
+#define TRISESET HOST_SFR(HOST_TRISE, HOST_SET)
+#define TRISEINV HOST_SFR(HOST_TRISE, HOST_INV)
+
+#define PORTE HOST_SFR(HOST_PORTE, HOST_BASE)
+#define PORTECLR HOST_SFR(HOST_PORTE, HOST_CLR)
+#define PORTESET HOST_SFR(HOST_PORTE, HOST_SET)
+#define PORTEINV HOST_SFR(HOST_PORTE, HOST_INV)
+
+#define ODCE HOST_SFR(HOST_ODCE, HOST_BASE)
+#define ODCECLR HOST_SFR(HOST_ODCE, HOST_CLR)
+#define ODCESET HOST_SFR(HOST_ODCE, HOST_SET)
+#define ODCEINV HOST_SFR(HOST_ODCE, HOST_INV)
+
+#define TRISF HOST_SFR(HOST_TRISF, HOST_BASE)
+#define TRISFCLR HOST_SFR(HOST_TRISF, HOST_CLR)
+#define TRISFSET HOST_SFR(HOST_TRISF, HOST_SET)
+#define TRISFINV HOST_SFR(HOST_TRISF, HOST_INV)
+
+#define PORTF HOST_SFR(HOST_PORTF, HOST_BASE)
+#define PORTFCLR HOST_SFR(HOST_PORTF, HOST_CLR)
+#define PORTFSET HOST_SFR(HOST_PORTF, HOST_SET)
+#define PORTFINV HOST_SFR(HOST_PORTF, HOST_INV)
+
+#define ODCF HOST_SFR(HOST_ODCF, HOST_BASE)
+#define ODCFCLR HOST_SFR(HOST_ODCF, HOST_CLR)
+#define ODCFSET HOST_SFR(HOST_ODCF, HOST_SET)
+#define ODCFINV HOST_SFR(HOST_ODCF, HOST_INV)
+
+#define TRISG HOST_SFR(HOST_TRISG, HOST_BASE)
+#define TRISGCLR HOST_SFR(HOST_TRISG, HOST_CLR)
+#define TRISGSET HOST_SFR(HOST_TRISG, HOST_SET)
+#define TRISGINV HOST_SFR(HOST_TRISG, HOST_INV)
+
+#define PORTG HOST_SFR(HOST_PORTG, HOST_BASE)
+#define PORTGCLR HOST_SFR(HOST_PORTG, HOST_CLR)
+#define PORTGSET HOST_SFR(HOST_PORTG, HOST_SET)
+#define PORTGINV HOST_SFR(HOST_PORTG, HOST_INV)
+
+#define ODCG HOST_SFR(HOST_ODCG, HOST_BASE)
+#define ODCGCLR HOST_SFR(HOST_ODCG, HOST_CLR)
+#define ODCGSET HOST_SFR(HOST_ODCG, HOST_SET)
+#define ODCGINV HOST_SFR(HOST_ODCG, HOST_INV)
+
+// interrupt flag, enable and priority registers by number, like IFS(1)
+#define IFS(n) HOST_SFR(HOST_IFS0 + (n), HOST_BASE)
+#define IFSCLR(n) HOST_SFR(HOST_IFS0 + (n), HOST_CLR)
+#define IFSSET(n) HOST_SFR(HOST_IFS0 + (n), HOST_SET)
+#define IFSINV(n) HOST_SFR(HOST_IFS0 + (n), HOST_INV)
+#define IEC(n) HOST_SFR(HOST_IEC0 + (n), HOST_BASE)
+#define IECCLR(n) HOST_SFR(HOST_IEC0 + (n), HOST_CLR)
+#define IECSET(n) HOST_SFR(HOST_IEC0 + (n), HOST_SET)
+#define IECINV(n) HOST_SFR(HOST_IEC0 + (n), HOST_INV)
+#define IPC(n) HOST_SFR(HOST_IPC0 + (n), HOST_BASE)
+#define IPCCLR(n) HOST_SFR(HOST_IPC0 + (n), HOST_CLR)
+#define IPCSET(n) HOST_SFR(HOST_IPC0 + (n), HOST_SET)
+#define IPCINV(n) HOST_SFR(HOST_IPC0 + (n), HOST_INV)
+
+#endif
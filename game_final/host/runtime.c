@@ -0,0 +1,586 @@
+/**
+ * Host runtime. Runs the unchanged game on a virtual clock: the
+ * registers of host/pic32mx.h are plain words, timers 2 and 3, SPI2,
+ * the UART1 transmitter and the buttons are emulated from the core timer count, and the
+ * interrupts the game enables are taken between register accesses.
+ * Nothing waits for real time, wait_for_interrupt jumps straight to
+ * the next event, so a game runs many times faster than on the board.
+ *
+ * Usage: outfile-host [-t seconds] [-d] [-u file] [script]
+ *   -t  virtual seconds to run, 60 by default
+ *   -d  print the display as it was left when the run ends
+ *   -u  write the bytes UART1 sends to file, a pty or - for stdout
+ * Built with DEBUGFLAGS=-DDISPLAY_STATS or -DPROFILE the display
+ * traffic or frame phase reports follow the run report. The core timer
+ * only moves on register accesses and calls to read_core_timer, so
+ * phase times on the host are bus time, not CPU time.
+ * Every line of the script is
+ *   <milliseconds> <btn1|btn2|btn3|btn4|sw1|sw4> <0|1>
+ * and sets the pin at that virtual time, lines are in time order.
+ * Blank lines and lines starting with # are ignored. Without a script
+ * no button is ever pressed.
+ *
+ * The game's main is built as target_main, see the host target of the Makefile.
+ * Built with -DHOST_TEST there is no main, a test drives the modules it
+ * links itself through the calls in host/host.h.
+ * For copyright and licensing, see file COPYING
+ */
+#undef main
+#include <stdio.h>   // Enable use of printf
+#include <stdlib.h>  // Enable use of exit
+#include <string.h>  // Enable use of strcmp
+#include <time.h>    // Enable use of clock
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable access to the register stand-in
+#include "isr.h"     // Link with the interrupt helpers the game calls
+#include "host.h"    // Link with the test hooks
+#include "report.h"  // Enable access to the debug reports
+
+#define CORE_HZ 40000000  // the core timer counts at half the 80 MHz system clock
+#define ACCESS_TICKS 1    // core ticks a register access takes
+#define CALL_TICKS 4      // core ticks a call to read_core_timer takes
+#define ISR_LIMIT 100000  // interrupts taken back to back before a flag counts as stuck
+#define SCRIPT_MAX 65536  // script lines
+
+#define SPI2_RX_FLAG (1 << 7) // IFS(1)
+#define CN_FLAG (1 << 0)      // IFS(1)
+#define INT4_FLAG (1 << 19)   // IFS(0)
+#define U1TX_FLAG (1 << 28)   // IFS(0)
+#define UART_FIFO 4           // bytes the transmit FIFO holds, the one being shifted out included
+
+int target_main(void);
+
+static uint32_t sfr[HOST_REGISTERS];
+static uint32_t slot;       // word handed out for SET, CLR and INV writes and SPI2BUF
+static int16_t pending = -1; // register slot belongs to, applied on the next access
+static uint8_t pending_op;
+
+static uint64_t now; // core ticks since reset
+static uint64_t end; // core ticks the run stops at
+static uint8_t interrupts_on, in_isr;
+
+static uint64_t timer_pb[2]; // peripheral bus clocks into the period of timers 2 and 3
+
+static uint8_t spi_busy;   // a byte is being shifted out
+static uint8_t spi_byte;   // the byte
+static uint8_t spi_dc;     // D/C when it was written
+static uint64_t spi_done;  // core tick it has been shifted out
+
+void (*host_spi_trace)(uint8_t byte, uint8_t dc); // sees every byte that leaves SPI2
+
+static uint8_t uart_fifo[UART_FIFO];
+static uint8_t uart_count;  // bytes in uart_fifo, the first is being shifted out
+static uint64_t uart_done;  // core tick the first has been shifted out
+static FILE *uart_out;      // where the bytes go, nowhere without -u
+
+/* Input pins and the script that moves them */
+struct script_line
+{
+    uint64_t at;  // core tick
+    uint8_t pin;  // HOST_BTN1 to HOST_SW4
+    uint8_t level;
+};
+static struct script_line *script;
+static uint32_t script_len, script_next;
+static uint8_t pins; // bit HOST_BTN1 to HOST_SW4
+
+/* SSD1306 model, enough to follow the windows the game writes to */
+static uint8_t gram[4][128];
+static uint8_t col, col_first, col_last = 127, page, page_first, page_last = 3;
+static uint8_t command, args_wanted, args_seen, args[2];
+
+/* Statistics for the report */
+static uint64_t stat_interrupts, stat_spi_data, stat_spi_command, stat_uart, stat_accesses;
+static uint64_t stat_timer[2];
+static uint8_t dump_display;
+static clock_t started;
+
+static void report(void)
+{
+    double real = (double)(clock() - started) / CLOCKS_PER_SEC;
+    double virt = (double)now / CORE_HZ;
+
+    fprintf(stderr, "virtual time     %10.3f s\n", virt);
+    fprintf(stderr, "real time        %10.3f s (%.0fx)\n", real, real > 0 ? virt / real : 0);
+    fprintf(stderr, "game ticks       %10llu\n", (unsigned long long)stat_timer[0]);
+    fprintf(stderr, "animation frames %10llu\n", (unsigned long long)stat_timer[1]);
+    fprintf(stderr, "interrupts       %10llu\n", (unsigned long long)stat_interrupts);
+    fprintf(stderr, "register access  %10llu\n", (unsigned long long)stat_accesses);
+    fprintf(stderr, "spi data bytes   %10llu\n", (unsigned long long)stat_spi_data);
+    fprintf(stderr, "spi command bytes%10llu\n", (unsigned long long)stat_spi_command);
+    if (stat_uart)
+        fprintf(stderr, "uart bytes       %10llu\n", (unsigned long long)stat_uart);
+}
+
+/**
+ * Prints the panel the way up the game is played, the side panel on top
+ */
+static void print_display(void)
+{
+    int c, x;
+
+    for (c = 127; c >= 0; c--)
+    {
+        for (x = 0; x < 32; x++)
+            putchar((gram[x / 8][c] >> (x % 8)) & 1 ? '#' : '.');
+        putchar('\n');
+    }
+}
+
+#if defined(DISPLAY_STATS) || defined(PROFILE)
+static void print_line(const char *text)
+{
+    fprintf(stderr, "%s\n", text);
+}
+#endif
+
+static void finish(void)
+{
+    if (dump_display)
+        print_display();
+    if (uart_out)
+        fflush(uart_out);
+    report();
+#if defined(DISPLAY_STATS) || defined(PROFILE)
+    report_write(print_line);
+#endif
+    exit(0);
+}
+
+/**
+ * Takes one byte off the SPI2 bus into the panel model
+ */
+static void display_byte(uint8_t b, uint8_t dc)
+{
+    if (dc)
+    { // data goes to the window, wrapping like horizontal addressing
+        stat_spi_data++;
+        gram[page & 3][col & 127] = b;
+        if (col == col_last)
+        {
+            col = col_first;
+            page = page == page_last ? page_first : page + 1;
+        }
+        else
+            col++;
+        return;
+    }
+
+    stat_spi_command++;
+    if (args_seen < args_wanted)
+    {
+        args[args_seen++] = b;
+        if (args_seen < args_wanted)
+            return;
+        if (command == 0x21)
+        {
+            col = col_first = args[0] & 127;
+            col_last = args[1] & 127;
+        }
+        else if (command == 0x22)
+        {
+            page = page_first = args[0] & 3;
+            page_last = args[1] & 3;
+        }
+        args_wanted = 0;
+        return;
+    }
+
+    command = b;
+    args_seen = 0;
+    if (b == 0x21 || b == 0x22)
+        args_wanted = 2;
+    else if (b == 0x20 || b == 0x81 || b == 0x8D || b == 0xA8 || b == 0xD3 || b == 0xD5 || b == 0xD9 || b == 0xDA || b == 0xDB)
+        args_wanted = 1;
+    else
+        args_wanted = 0;
+}
+
+/**
+ * Peripheral bus clocks in one period of timer 2 (t = 0) or timer 3 (t = 1)
+ */
+static uint64_t timer_period(int t)
+{
+    static const uint16_t prescale[8] = {1, 2, 4, 8, 16, 32, 64, 256};
+    uint32_t con = sfr[t ? HOST_T3CON : HOST_T2CON];
+    uint32_t pr = sfr[t ? HOST_PR3 : HOST_PR2];
+    return (uint64_t)prescale[(con >> 4) & 7] * (pr + 1);
+}
+
+static uint8_t timer_on(int t)
+{
+    return (sfr[t ? HOST_T3CON : HOST_T2CON] >> 15) & 1;
+}
+
+/**
+ * Core ticks UART1 takes for one byte, 10 bits at the rate U1BRG sets
+ */
+static uint64_t uart_byte_ticks(void)
+{
+    uint32_t per_bit = (sfr[HOST_U1MODE] & 0x0008) ? 4 : 16; // bus clocks per bit and BRG count
+    return 10 * per_bit * (sfr[HOST_U1BRG] + 1) / 2;
+}
+
+/**
+ * Shows the FIFO in U1STA and keeps the transmit flag raised while it has room
+ */
+static void uart_status(void)
+{
+    sfr[HOST_U1STA] &= ~0x0300;
+    if (uart_count == UART_FIFO)
+        sfr[HOST_U1STA] |= 0x0200; // UTXBF, full
+    if (!uart_count)
+        sfr[HOST_U1STA] |= 0x0100; // TRMT, everything sent
+    if ((sfr[HOST_U1MODE] & 0x8000) && (sfr[HOST_U1STA] & 0x0400) && uart_count < UART_FIFO)
+        sfr[HOST_IFS0] |= U1TX_FLAG;
+}
+
+/**
+ * Core tick of the next thing that happens without the game doing anything
+ */
+static uint64_t next_event(void)
+{
+    uint64_t next = end, at;
+    int t;
+
+    for (t = 0; t < 2; t++)
+    {
+        if (!timer_on(t))
+            continue;
+        at = now + (timer_period(t) - timer_pb[t] + 1) / 2; // 2 peripheral bus clocks per core tick
+        if (at < next)
+            next = at;
+    }
+    if (spi_busy && spi_done < next)
+        next = spi_done;
+    if (uart_count && uart_done < next)
+        next = uart_done;
+    if (script_next < script_len && script[script_next].at < next)
+        next = script[script_next].at;
+    return next > now ? next : now + 1;
+}
+
+/**
+ * Moves a pin and raises the interrupts its edge causes
+ */
+static void set_pin(uint8_t pin, uint8_t level)
+{
+    uint8_t was = (pins >> pin) & 1;
+
+    if (was == level)
+        return;
+    pins ^= 1 << pin;
+
+    if (pin >= 1 && pin <= 3 && (sfr[HOST_CNCON] & 0x8000) && ((sfr[HOST_CNEN] >> (13 + pin)) & 1))
+        sfr[HOST_IFS1] |= CN_FLAG; // buttons 2-4 are CN14-16
+    if (pin == 5 && level == ((sfr[HOST_INTCON] >> 4) & 1))
+        sfr[HOST_IFS0] |= INT4_FLAG; // INT4 sees the edge INTCON bit 4 selects
+}
+
+/**
+ * Shows the pins in PORTD and PORTF, whatever was written to their latches
+ */
+static void update_ports(void)
+{
+    uint32_t d = ((pins >> 1) & 7) << 5 | ((pins >> 4) & 1) << 8 | ((pins >> 5) & 1) << 11;
+
+    sfr[HOST_PORTD] = (sfr[HOST_PORTD] & ~0x9E0) | d;
+    sfr[HOST_PORTF] = (sfr[HOST_PORTF] & ~0x2) | (pins & 1) << 1;
+}
+
+/**
+ * Runs the peripherals up to core tick to
+ */
+static void advance(uint64_t to)
+{
+    uint64_t step;
+    int t;
+
+    while (now < to)
+    {
+        step = next_event();
+        if (step > to)
+            step = to;
+
+        for (t = 0; t < 2; t++)
+        {
+            if (!timer_on(t))
+                continue;
+            timer_pb[t] += 2 * (step - now);
+            while (timer_pb[t] >= timer_period(t))
+            {
+                timer_pb[t] -= timer_period(t);
+                sfr[HOST_IFS0] |= t ? 1 << 12 : 1 << 8;
+                stat_timer[t]++;
+            }
+        }
+        now = step;
+
+        if (spi_busy && now >= spi_done)
+        {
+            spi_busy = 0;
+            display_byte(spi_byte, spi_dc);
+            if (host_spi_trace)
+                host_spi_trace(spi_byte, spi_dc);
+            if (sfr[HOST_SPI2STAT] & 1)
+                sfr[HOST_SPI2STAT] |= 0x40; // the last byte was never read, overflow
+            sfr[HOST_SPI2STAT] = (sfr[HOST_SPI2STAT] | 1) & ~0x800; // received, no longer busy
+            sfr[HOST_IFS1] |= SPI2_RX_FLAG;
+        }
+
+        if (uart_count && now >= uart_done)
+        {
+            if (uart_out)
+                fputc(uart_fifo[0], uart_out);
+            stat_uart++;
+            memmove(uart_fifo, uart_fifo + 1, --uart_count);
+            uart_done = now + uart_byte_ticks();
+            uart_status();
+        }
+
+        while (script_next < script_len && script[script_next].at <= now)
+        {
+            set_pin(script[script_next].pin, script[script_next].level);
+            script_next++;
+        }
+
+        if (now >= end)
+            finish();
+    }
+    update_ports();
+}
+
+/**
+ * Carries out the SET, CLR, INV or SPI2BUF write handed out last
+ */
+static void apply_pending(void)
+{
+    if (pending < 0)
+        return;
+
+    if (pending == HOST_SPI2BUF)
+    {
+        if (!(slot & 0x80000000) && (sfr[HOST_SPI2CON] & 0x8000))
+        { // a write, shift it out at the rate SPI2BRG sets
+            spi_busy = 1;
+            spi_byte = slot;
+            spi_dc = (sfr[HOST_PORTF] >> 4) & 1;
+            spi_done = now + 8 * (sfr[HOST_SPI2BRG] + 1); // 2 * (BRG + 1) bus clocks per bit
+            sfr[HOST_SPI2STAT] |= 0x800;
+        }
+    }
+    else if (pending == HOST_U1TXREG)
+    {
+        if (!(slot & 0x80000000) && (sfr[HOST_U1MODE] & 0x8000) && (sfr[HOST_U1STA] & 0x0400) && uart_count < UART_FIFO)
+        { // a write goes into the FIFO, bytes written to a full FIFO are lost like on the board
+            if (!uart_count)
+                uart_done = now + uart_byte_ticks();
+            uart_fifo[uart_count++] = slot;
+        }
+    }
+    else if (pending_op == HOST_CLR)
+        sfr[pending] &= ~slot;
+    else if (pending_op == HOST_SET)
+        sfr[pending] |= slot;
+    else if (pending_op == HOST_INV)
+        sfr[pending] ^= slot;
+    pending = -1;
+    update_ports();
+    uart_status();
+}
+
+/**
+ * Takes every interrupt that is flagged and enabled, one after the other
+ */
+static void take_interrupts(void)
+{
+    uint32_t n = 0;
+
+    if (!interrupts_on || in_isr)
+        return;
+    while ((sfr[HOST_IFS0] & sfr[HOST_IEC0]) | (sfr[HOST_IFS1] & sfr[HOST_IEC1]))
+    {
+        if (++n > ISR_LIMIT)
+        {
+            fprintf(stderr, "host: interrupt flags %08x %08x are never cleared\n",
+                    sfr[HOST_IFS0] & sfr[HOST_IEC0], sfr[HOST_IFS1] & sfr[HOST_IEC1]);
+            exit(1);
+        }
+        in_isr = 1;
+        stat_interrupts++;
+        user_isr();
+        apply_pending();
+        in_isr = 0;
+    }
+}
+
+/**
+ * Every register access of the game comes here
+ */
+volatile uint32_t *host_sfr(uint8_t reg, uint8_t op)
+{
+    apply_pending();
+    advance(now + ACCESS_TICKS);
+    take_interrupts();
+    stat_accesses++;
+
+    if (reg == HOST_SPI2BUF)
+    { // reads take the received byte, a write shows as bit 31 going clear
+        sfr[HOST_SPI2STAT] &= ~1;
+        slot = 0x80000000 | sfr[HOST_SPI2BUF];
+        pending = reg;
+        return &slot;
+    }
+    if (reg == HOST_U1TXREG)
+    { // a write shows as bit 31 going clear, like SPI2BUF
+        slot = 0x80000000;
+        pending = reg;
+        return &slot;
+    }
+    if (op == HOST_BASE)
+        return &sfr[reg];
+    slot = 0;
+    pending = reg;
+    pending_op = op;
+    return &slot;
+}
+
+void enable_interrupt(void)
+{
+    apply_pending();
+    interrupts_on = 1;
+    take_interrupts();
+}
+
+uint32_t read_core_timer(void)
+{
+    apply_pending();
+    advance(now + CALL_TICKS);
+    take_interrupts();
+    return (uint32_t)now;
+}
+
+/**
+ * Skips virtual time to the next interrupt instead of sleeping
+ */
+void wait_for_interrupt(void)
+{
+    apply_pending();
+    while (!((sfr[HOST_IFS0] & sfr[HOST_IEC0]) | (sfr[HOST_IFS1] & sfr[HOST_IEC1])))
+        advance(next_event());
+    take_interrupts();
+}
+
+/**
+ * Resets the board to the state the game starts in and runs it for seconds
+ */
+void host_start(double seconds)
+{
+    end = now + (uint64_t)(seconds * CORE_HZ);
+    sfr[HOST_SPI2STAT] = 0x08; // transmit buffer empty
+    update_ports();
+    started = clock();
+}
+
+/**
+ * Byte column of page on the panel model
+ */
+uint8_t host_panel(uint8_t page, uint8_t column)
+{
+    return gram[page & 3][column & 127];
+}
+
+/**
+ * Whether the code running was called from user_isr
+ */
+uint8_t host_in_isr(void)
+{
+    return in_isr;
+}
+
+/**
+ * Adds a line to the script, pin is HOST_BTN1 to HOST_SW4
+ * @return 0 if the script is full or ms is before the line before
+ */
+uint8_t host_pin(double ms, uint8_t pin, uint8_t level)
+{
+    uint64_t at = (uint64_t)(ms * (CORE_HZ / 1000));
+
+    if (!script)
+        script = calloc(SCRIPT_MAX, sizeof(*script));
+    if (pin >= 6 || script_len == SCRIPT_MAX || (script_len && at < script[script_len - 1].at))
+        return 0;
+    script[script_len].at = at;
+    script[script_len].pin = pin;
+    script[script_len].level = level;
+    script_len++;
+    return 1;
+}
+
+#ifndef HOST_TEST
+static const char *pin_names[] = {"btn1", "btn2", "btn3", "btn4", "sw1", "sw4"}; // HOST_BTN1 to HOST_SW4
+
+static void load_script(const char *path)
+{
+    FILE *f = fopen(path, "r");
+    char line[256], name[32];
+    double ms;
+    int level, p, n = 0;
+
+    if (!f)
+    {
+        fprintf(stderr, "host: cannot open %s\n", path);
+        exit(1);
+    }
+    while (fgets(line, sizeof(line), f))
+    {
+        n++;
+        if (line[0] == '#' || sscanf(line, "%lf %31s %d", &ms, name, &level) != 3)
+            continue;
+        for (p = 0; p < 6 && strcmp(name, pin_names[p]); p++)
+            ;
+        if (p == 6 || !host_pin(ms, p, level != 0))
+        {
+            fprintf(stderr, "host: %s:%d: cannot use %s", path, n, line);
+            exit(1);
+        }
+    }
+    fclose(f);
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 60;
+    int i;
+
+    for (i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "-t") && i + 1 < argc)
+            seconds = atof(argv[++i]);
+        else if (!strcmp(argv[i], "-d"))
+            dump_display = 1;
+        else if (!strcmp(argv[i], "-u") && i + 1 < argc)
+        {
+            i++;
+            uart_out = strcmp(argv[i], "-") ? fopen(argv[i], "wb") : stdout;
+            if (!uart_out)
+            {
+                fprintf(stderr, "host: cannot open %s\n", argv[i]);
+                return 1;
+            }
+        }
+        else if (argv[i][0] != '-')
+            load_script(argv[i]);
+        else
+        {
+            fprintf(stderr, "usage: %s [-t seconds] [-d] [-u file] [script]\n", argv[0]);
+            return 1;
+        }
+    }
+
+    host_start(seconds);
+    target_main();
+    finish();
+    return 0;
+}
+#endif
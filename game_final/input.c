@@ -0,0 +1,277 @@
+/**
+ * Input edges. Buttons 2-4 raise change notice interrupts and switch 4
+ * raises external interrupt 4, so every press and release is recorded
+ * with its time even while the game is busy rendering. Button 1 is on a
+ * pin without change notice and is sampled every animation frame, and
+ * so is switch 1, which only turns the ghost on and off.
+ * A contact bounces for a few milliseconds when it closes or opens, so
+ * after an edge of an input is accepted further edges of that input are
+ * dropped for INPUT_DEBOUNCE_US. Every animation frame all pins are read
+ * again, so the level a contact settles at is recorded once its lockout
+ * is over even if no edge comes after it.
+ * The game reads events made from the edges: presses, releases and,
+ * for held buttons, repeats after a delay at a fixed rate, all timed
+ * in animation frames so they do not depend on how long a pass takes.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable use of chipkit specific macros
+#include "clock.h"   // Enable access to the microsecond clock
+#include "input.h"   // Link with input header file
+
+#define INPUT_QUEUE 16  // edges the queue holds, a power of 2
+#define INPUT_EVENTS 32 // events the event queue holds, a power of 2
+
+static struct input_edge queue[INPUT_QUEUE];
+static volatile uint8_t queued;   // edges written by the interrupts
+static uint8_t consumed;          // edges read by the game
+static volatile uint8_t state;    // INPUT bits down at the last edge
+static uint32_t accepted[6];      // clock_us of the last accepted edge of each input
+
+static struct input_event events[INPUT_EVENTS];
+static uint8_t events_queued;     // events made from edges and repeats
+static uint8_t events_consumed;   // events read by the game
+static uint8_t repeating;         // INPUT_REPEATS bits that are held down
+static uint32_t due[4];           // clock_frames of the next repeat of each button
+
+/**
+ * Reads every input pin, reading PORTD also ends the change notice mismatch
+ */
+static uint8_t read_pins(void)
+{
+    uint32_t d = PORTD;
+    return ((PORTF >> 1) & 1) | ((d >> 4) & 0x0E) | (((d >> 11) & 1) << 4) | (((d >> 8) & 1) << 5);
+}
+
+/**
+ * Queues an edge if inputs changed that are not locked out after their
+ * last edge. Only called from interrupts of the same priority, so they
+ * never interrupt each other.
+ */
+static void record(uint8_t now)
+{
+    struct input_edge *e;
+    uint8_t changed = now ^ state;
+    uint32_t us;
+    uint8_t b;
+
+    if (!changed)
+        return;
+
+    us = clock_us();
+    for (b = 0; b < 6; b++)
+        if (((changed >> b) & 1) && us - accepted[b] < INPUT_DEBOUNCE_US)
+            changed &= ~(1 << b); // a bounce, the frame sample picks up where it settles
+    if (!changed)
+        return;
+    now = (state & ~changed) | (now & changed);
+    for (b = 0; b < 6; b++)
+        if ((changed >> b) & 1)
+            accepted[b] = us;
+
+    if ((uint8_t)(queued - consumed) < INPUT_QUEUE)
+    {
+        e = &queue[queued % INPUT_QUEUE];
+        e->pressed = 0;
+        e->released = 0;
+        queued++;
+    }
+    else
+        e = &queue[(queued - 1) % INPUT_QUEUE]; // full, merge into the newest edge
+
+    e->us = us;
+    e->frame = clock_frames;
+    e->state = now;
+    e->pressed |= changed & now;
+    e->released |= changed & ~now;
+    state = now;
+}
+
+/**
+ * Sets up the input pins and their interrupts
+ */
+void input_init(void)
+{
+    uint8_t b;
+
+    TRISFSET = 1 << 1;               // button 1
+    TRISDSET = 0xE0 | (1 << 8) | (1 << 11); // buttons 2-4 and switches 1 and 4
+
+    state = read_pins();
+    for (b = 0; b < 6; b++)
+        accepted[b] = clock_us() - INPUT_DEBOUNCE_US;
+
+    CNCON = 0x8000;                  // change notice on
+    CNEN = (1 << 14) | (1 << 15) | (1 << 16);
+    IPCCLR(6) = 0x1F << 16;          // change notice priority 2, same as the timers
+    IPCSET(6) = 2 << 18;
+    IFSCLR(1) = CN_IRQ;
+    IECSET(1) = CN_IRQ;
+
+    if (state & INPUT_SW4)           // INT4 only sees one edge, wait for the other one
+        INTCONCLR = 1 << 4;
+    else
+        INTCONSET = 1 << 4;
+    IPCCLR(4) = 0x1F << 24;          // external interrupt 4 priority 2
+    IPCSET(4) = 2 << 26;
+    IFSCLR(0) = INT4_IRQ;
+    IECSET(0) = INT4_IRQ;
+}
+
+/**
+ * Change notice interrupt, one of buttons 2-4 changed
+ */
+void input_service_change(void)
+{
+    uint8_t now = read_pins(); // read before the flag is cleared, or it is raised again
+    IFSCLR(1) = CN_IRQ;
+    record(now);
+}
+
+/**
+ * External interrupt 4, switch 4 changed
+ */
+void input_service_int4(void)
+{
+    uint8_t now = read_pins();
+
+    if (now & INPUT_SW4) // look for the opposite edge next
+        INTCONCLR = 1 << 4;
+    else
+        INTCONSET = 1 << 4;
+    IFSCLR(0) = INT4_IRQ;
+    record(now);
+}
+
+/**
+ * Samples button 1 and switch 1, and every other input whose last edge
+ * was dropped as a bounce, called every animation frame
+ */
+void input_sample(void)
+{
+    record(read_pins());
+}
+
+/**
+ * INPUT bits that are down right now
+ */
+uint8_t input_held(void)
+{
+    return state;
+}
+
+/**
+ * Takes the oldest edge from the queue
+ * @return 0 if there was none
+ */
+static uint8_t input_next(struct input_edge *e)
+{
+    if (consumed == queued)
+        return 0;
+
+    IECCLR(1) = CN_IRQ; // the newest edge may be merged into while it is copied
+    IECCLR(0) = INT4_IRQ | T3_IRQ;
+    *e = queue[consumed % INPUT_QUEUE];
+    consumed++;
+    IECSET(1) = CN_IRQ;
+    IECSET(0) = INT4_IRQ | T3_IRQ;
+    return 1;
+}
+
+/**
+ * Queues an event, the caller makes sure there is room
+ */
+static void push_event(uint32_t frame, uint8_t button, uint8_t kind)
+{
+    struct input_event *ev = &events[events_queued % INPUT_EVENTS];
+    ev->frame = frame;
+    ev->button = button;
+    ev->kind = kind;
+    events_queued++;
+}
+
+/**
+ * Queues the repeats of held buttons that are due by frame now
+ */
+static void push_repeats(uint32_t now)
+{
+    uint8_t b;
+
+    for (b = 0; b < 4; b++)
+    {
+        while (((repeating >> b) & 1) && (int32_t)(now - due[b]) >= 0)
+        {
+            if ((uint8_t)(events_queued - events_consumed) == INPUT_EVENTS)
+                return; // the rest are made when there is room, still at their own frames
+            push_event(due[b], 1 << b, INPUT_REPEAT);
+            due[b] += b == 0 ? INPUT_DROP_FRAMES : INPUT_ARR_FRAMES;
+        }
+    }
+}
+
+/**
+ * Turns new edges and repeats that are due into events, in the order they happened
+ */
+static void make_events(void)
+{
+    struct input_edge e;
+    uint8_t b;
+
+    // an edge makes at most 6 events, it waits in the edge queue until there is room
+    while ((uint8_t)(events_queued - events_consumed) <= INPUT_EVENTS - 6 && input_next(&e))
+    {
+        push_repeats(e.frame);
+        for (b = 0; b < 6; b++)
+        {
+            // a merged edge can hold both, the state tells which came last
+            if ((e.released >> b) & (e.state >> b) & 1)
+                push_event(e.frame, 1 << b, INPUT_RELEASE);
+            if ((e.pressed >> b) & 1)
+            {
+                push_event(e.frame, 1 << b, INPUT_PRESS);
+                if ((INPUT_REPEATS >> b) & 1)
+                {
+                    repeating |= 1 << b;
+                    due[b] = e.frame + (b == 0 ? INPUT_DROP_FRAMES : INPUT_DAS_FRAMES);
+                }
+            }
+            if ((e.released >> b) & ~(e.state >> b) & 1)
+            {
+                push_event(e.frame, 1 << b, INPUT_RELEASE);
+                repeating &= ~(1 << b);
+            }
+        }
+    }
+    push_repeats(clock_frames);
+}
+
+/**
+ * Takes the oldest input event
+ * @return 0 if there was none
+ */
+uint8_t input_event(struct input_event *ev)
+{
+    if (events_consumed == events_queued)
+        make_events();
+    if (events_consumed == events_queued)
+        return 0;
+
+    *ev = events[events_consumed % INPUT_EVENTS];
+    events_consumed++;
+    return 1;
+}
+
+/**
+ * Takes every input event
+ * @return INPUT bits pressed since the last call, taps included
+ */
+uint8_t input_pressed(void)
+{
+    struct input_event ev;
+    uint8_t pressed = 0;
+
+    while (input_event(&ev))
+        if (ev.kind == INPUT_PRESS)
+            pressed |= ev.button;
+    return pressed;
+}
@@ -0,0 +1,65 @@
+/**
+ * Header file for input.c
+ * Button and switch 4 edges, recorded by interrupts
+ */
+
+#define CN_IRQ (1 << 0)    // change notice flag in IFS(1)/IEC(1)
+#define INT4_IRQ (1 << 19) // external interrupt 4 flag in IFS(0)/IEC(0)
+
+#define INPUT_BTN1 (1 << 0) // button 1, RF1
+#define INPUT_BTN2 (1 << 1) // button 2, RD5 on CN14
+#define INPUT_BTN3 (1 << 2) // button 3, RD6 on CN15
+#define INPUT_BTN4 (1 << 3) // button 4, RD7 on CN16
+#define INPUT_SW4 (1 << 4)  // switch 4, RD11 on INT4
+#define INPUT_SW1 (1 << 5)  // switch 1, RD8, sampled like button 1
+#define INPUT_BTNS 0x0F     // every button
+#define INPUT_REPEATS (INPUT_BTN1 | INPUT_BTN3 | INPUT_BTN4) // buttons that repeat while held
+
+#ifndef INPUT_DAS_FRAMES
+#define INPUT_DAS_FRAMES 42 // clock_frames from pressing button 3 or 4 to its first repeat, 168 ms
+#endif
+#ifndef INPUT_ARR_FRAMES
+#define INPUT_ARR_FRAMES 8 // clock_frames between repeats of button 3 or 4, 32 ms
+#endif
+#ifndef INPUT_DROP_FRAMES
+#define INPUT_DROP_FRAMES 8 // clock_frames between soft drop repeats of button 1, 32 ms
+#endif
+
+#ifndef INPUT_DEBOUNCE_US
+#define INPUT_DEBOUNCE_US 5000 // edges of an input this soon after its last accepted edge are contact bounce
+#endif
+
+#define INPUT_PRESS 0   // the button went down
+#define INPUT_REPEAT 1  // the button is still down and repeats
+#define INPUT_RELEASE 2 // the button went up
+
+/**
+ * Inputs that changed at one moment. Edges that did not fit in the
+ * queue are merged into the last one, so no press is ever lost.
+ */
+struct input_edge
+{
+    uint32_t us;      // clock_us when it happened
+    uint32_t frame;   // clock_frames when it happened
+    uint8_t state;    // INPUT bits that are down after it
+    uint8_t pressed;  // INPUT bits that went down
+    uint8_t released; // INPUT bits that went up
+};
+
+/**
+ * One press, repeat or release of one button
+ */
+struct input_event
+{
+    uint32_t frame; // clock_frames it happened or was due
+    uint8_t button; // one INPUT bit
+    uint8_t kind;   // INPUT_PRESS, INPUT_REPEAT or INPUT_RELEASE
+};
+
+void input_init(void);
+void input_service_change(void);
+void input_service_int4(void);
+void input_sample(void);
+uint8_t input_held(void);
+uint8_t input_event(struct input_event *ev);
+uint8_t input_pressed(void);
@@ -0,0 +1,37 @@
+/**
+ * Interrupt dispatch. vectors.S routes every interrupt vector here
+ * and each peripheral with a pending flag gets serviced.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable use of chipkit specific macros
+#include "spi.h"     // Enable access to the SPI transfer queue
+#include "clock.h"   // Enable access to the timer handlers
+#include "input.h"   // Enable access to the input handlers
+#include "gamedata.h" // Enable use of the well types telemetry.h refers to
+#include "telemetry.h" // Enable access to the telemetry transmitter
+#include "isr.h"     // Link with isr header file
+
+/**
+ * Called from isr_wrapper in vectors.S on every interrupt
+ */
+void user_isr(void)
+{
+    if ((IFS(1) & SPI2_RX_IRQ) && (IEC(1) & SPI2_RX_IRQ))
+        spi_service();
+    if (IFS(0) & T2_IRQ)
+        clock_service_tick();
+    if (IFS(0) & T3_IRQ)
+    {
+        clock_service_frame();
+        input_sample();
+    }
+    if (IFS(1) & CN_IRQ)
+        input_service_change();
+    if (IFS(0) & INT4_IRQ)
+        input_service_int4();
+#ifdef TELEMETRY
+    if ((IFS(0) & U1TX_IRQ) && (IEC(0) & U1TX_IRQ))
+        telemetry_service();
+#endif
+}
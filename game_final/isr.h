@@ -0,0 +1,7 @@
+/**
+ * Header file for isr.c and the interrupt helpers in vectors.S
+ */
+void user_isr(void);
+void enable_interrupt(void);
+uint32_t read_core_timer(void);
+void wait_for_interrupt(void);
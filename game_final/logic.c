@@ -0,0 +1,442 @@
+/**
+ * Game logic. Everything here works on the game state it is handed and
+ * nothing else: no registers, no display and no buttons, so a game can
+ * be stepped on the board, on the host or many times side by side.
+ * The caller reads the buttons and the clock and draws the result.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>	  // Enable use of uintX_t
+#include "gamedata.h" // Enable access to game data
+#include "logic.h"	  // Link with logic header file
+
+/**
+ * Sets the highscore shown next to the score
+ * Only done when the highscore to beat changes, so formatting it here is cheap
+ * @param score The new highscore
+ */
+static void set_high_score(struct game_state *g, uint32_t score)
+{
+	uint8_t d, n;
+
+	g->high_score = score;
+	for (d = 6; d-- > 0;)
+	{
+		n = score % 10;
+		score /= 10;
+		if (n != g->score_digits[0][d])
+		{
+			g->score_digits[0][d] = n;
+			g->panel_dirty |= PANEL_DIGIT(0, d);
+		}
+	}
+}
+
+/**
+ * Empties the field for a new game
+ */
+static void clear_field(struct game_state *g)
+{
+	uint8_t i;
+	for (i = 0; i < WELL_HEIGHT; i++)
+		g->field[i] = g->ghost[i] = 0;
+	for (i = 0; i < WELL_WIDTH; i++)
+		g->column_top[i] = WELL_HEIGHT;
+	g->ghost_h = 0;
+	g->completed_rows = 0;
+}
+
+/**
+ * Starts a new game: empty field, no score, the highscore to beat taken
+ * from the list and the first figure on the field. Whether the ghost is
+ * shown is left as the caller set it.
+ * @param seed the figure sequence, the same seed and mode give the same game
+ * @param mode RANDOM_BAG or RANDOM_NO_REPEAT
+ */
+void game_reset(struct game_state *g, uint32_t highscores[5][5], uint32_t seed, uint8_t mode)
+{
+	uint8_t d;
+
+	clear_field(g);
+
+	// set score and highscore
+	g->highscore_to_beat = 4;
+	while (!highscores[g->highscore_to_beat][4] && g->highscore_to_beat > 0)
+		g->highscore_to_beat--;
+	set_high_score(g, highscores[g->highscore_to_beat][4]);
+	g->current_score = 0;
+	for (d = 0; d < 6; d++)
+		g->score_digits[1][d] = 0;
+	g->panel_dirty = PANEL_DIRTY_ALL;
+
+	// set timing variables
+	g->time_out_counter = 0;
+	g->time_out_value = 10;
+	g->speed_increase_counter = 0;
+	g->speed_increase_value = 30;
+
+	random_seed(&g->random, seed, mode);
+	select_shape(g);		  // randomize a new next
+	update_current_figure(g); // set current as next
+	select_shape(g);		  // randomize a new next
+	update_ghost(g);
+	add_figure_to_screen_field(g);
+}
+
+/**
+ * Updates the current figure to be what next figure is
+ * @author Olle Jernström
+ */
+void update_current_figure(struct game_state *g)
+{
+	// update movement vars and what num current figure is
+	g->figure_type = g->next_figure_type;
+	g->rotation = 0;
+	g->pos_x = shapes[g->figure_type][0].w;
+	g->pos_y = shapes[g->figure_type][0].h;
+}
+
+/**
+ * Randomizes the next figure
+ * it also resets the position for the next figure
+ * @author Olle Jernström
+ */
+void select_shape(struct game_state *g)
+{
+	g->next_figure_type = random_figure(&g->random);
+	g->panel_dirty |= PANEL_DIRTY_NEXT;
+	g->move_y = 0;
+	g->move_x = 0;
+	g->offset = (WELL_WIDTH - 4) / 2; // the middle, a standard well spawns in columns 3-6
+}
+
+/**
+ * Checks if a shape fits in the field with its box at column x and row y,
+ * without touching the current figure
+ */
+static uint8_t shape_fits(struct game_state *g, const struct shape *s, int8_t x, int8_t y)
+{
+	uint8_t i;
+	if (x < 0 || x + s->w > WELL_WIDTH || y < 0 || y + s->h > WELL_HEIGHT)
+		return 0;
+	for (i = 0; i < s->h; i++)
+		if (g->field[y + i] & (SHAPE_ROW(s->mask, i) << x))
+			return 0;
+	return 1;
+}
+
+/**
+ * The method adds our figure to the display (the field)
+ * @author Olle Jernström
+ */
+void add_figure_to_screen_field(struct game_state *g)
+{
+	uint16_t mask = shapes[g->figure_type][g->rotation].mask;
+	uint8_t i;
+	for (i = 0; i < g->pos_y; i++)
+		g->field[i + g->move_y] |= SHAPE_ROW(mask, i) << (g->offset + g->move_x);
+}
+
+/**
+ * The method removes our figure from the display (the field)
+ * @author Olle Jernström
+ */
+void remove_figure_from_screen_field(struct game_state *g)
+{
+	uint16_t mask = shapes[g->figure_type][g->rotation].mask;
+	uint8_t i;
+	for (i = 0; i < g->pos_y; i++)
+		g->field[i + g->move_y] &= ~(SHAPE_ROW(mask, i) << (g->offset + g->move_x));
+}
+
+/**
+ * Check path down. (if it is possible to move down in the y direction)
+ * @author Olle Jernström
+ */
+uint8_t check_if_move_possible_down(struct game_state *g)
+{
+	return shape_fits(g, &shapes[g->figure_type][g->rotation], g->offset + g->move_x, g->move_y + 1);
+}
+
+/**
+ * Check path right. (if it is possible to move right in the x direction)
+ * @author Olle Jernström
+ */
+uint8_t check_if_move_possible_right(struct game_state *g)
+{
+	return shape_fits(g, &shapes[g->figure_type][g->rotation], g->offset + g->move_x + 1, g->move_y);
+}
+
+/**
+ * Check path left. (if it is possible to move left in the x direction)
+ * @author Olle Jernström
+ */
+uint8_t check_if_move_possible_left(struct game_state *g)
+{
+	return shape_fits(g, &shapes[g->figure_type][g->rotation], g->offset + g->move_x - 1, g->move_y);
+}
+
+/**
+ * Finds the row the figure lands on if dropped straight down, from the
+ * column tops and the bottom cells of the figure, so only its columns are
+ * looked at. Called while the figure is not on the field.
+ */
+uint8_t landing_row(struct game_state *g)
+{
+	const struct shape *s = &shapes[g->figure_type][g->rotation];
+	uint8_t j, x = g->offset + g->move_x;
+	int8_t y, land = WELL_HEIGHT;
+
+	for (j = 0; j < s->w; j++)
+	{
+		y = g->column_top[x + j] - 1 - SHAPE_BOTTOM(s->bottom, j);
+		if (y < land)
+			land = y;
+	}
+	if (land < g->move_y)
+	{ // the figure was slid in under an overhang, the column tops are above it
+		land = g->move_y;
+		while (shape_fits(g, s, x, land + 1))
+			land++;
+	}
+	return land;
+}
+
+/**
+ * Raises the column tops to the figure that was just added to the field
+ */
+static void raise_columns(struct game_state *g)
+{
+	uint16_t mask = shapes[g->figure_type][g->rotation].mask;
+	uint8_t i, c;
+	well_row cells;
+
+	for (i = 0; i < g->pos_y; i++)
+	{
+		cells = SHAPE_ROW(mask, i) << (g->offset + g->move_x);
+		for (c = 0; cells; c++, cells >>= 1)
+			if ((cells & 1) && g->column_top[c] > g->move_y + i)
+				g->column_top[c] = g->move_y + i;
+	}
+}
+
+/**
+ * Places the ghost where the figure would land, or takes it away when
+ * the ghost is off. Called while the figure is not on the field.
+ */
+void update_ghost(struct game_state *g)
+{
+	uint16_t mask = shapes[g->figure_type][g->rotation].mask;
+	uint8_t i;
+
+	for (i = 0; i < g->ghost_h; i++)
+		g->ghost[g->ghost_y + i] = 0;
+	g->ghost_h = 0;
+	if (!g->ghost_on)
+		return;
+
+	g->ghost_y = landing_row(g);
+	g->ghost_h = g->pos_y;
+	for (i = 0; i < g->ghost_h; i++)
+		g->ghost[g->ghost_y + i] = SHAPE_ROW(mask, i) << (g->offset + g->move_x);
+}
+
+/**
+ * Rotates the figure clockwise if the rotated shape fits somewhere.
+ * The kicks of the rotation are tried in order against the field
+ * and the figure is moved by the first one that fits.
+ * @return 1 if the figure was rotated
+ */
+uint8_t rotate_figure(struct game_state *g)
+{
+	const struct shape *s = &shapes[g->figure_type][(g->rotation + 1) & 3];
+	const struct kick *k = kicks[g->figure_type][g->rotation];
+	uint8_t i;
+
+	for (i = 0; i < KICK_TESTS; i++, k++)
+	{
+		if (shape_fits(g, s, g->offset + g->move_x + k->x, g->move_y + k->y))
+		{
+			g->move_x += k->x;
+			g->move_y += k->y;
+			g->rotation = (g->rotation + 1) & 3;
+			g->pos_x = s->w;
+			g->pos_y = s->h;
+			return 1;
+		}
+	}
+	return 0;
+}
+
+/**
+ * Checks if there are any full rows.
+ * If thats the case they are stored so that they can be removed
+ * by remove_checked_completed_rows
+ * @author Olle Jernström
+ */
+void check_if_completed_rows_exist(struct game_state *g)
+{
+	uint8_t i;
+	g->completed_rows = 0;
+	for (i = 0; i < WELL_HEIGHT; i++)
+		if (g->field[i] == WELL_FULL)
+			g->completed_rows |= (well_rows)1 << i;
+}
+
+/**
+ * Removes the rows found by check_if_completed_rows_exist
+ * and scores them
+ * @author Olle Jernström
+ */
+void remove_checked_completed_rows(struct game_state *g)
+{
+	uint8_t r, k;
+
+	if (!g->completed_rows)
+		return;
+
+	k = WELL_HEIGHT;
+	for (r = WELL_HEIGHT; r-- > 0;) // move every row that stays down in one sweep
+		if (!((g->completed_rows >> r) & 1))
+			g->field[--k] = g->field[r];
+	increase_score(g, 10 * k); // k is now the number of rows removed
+
+	// full rows are all below every column top, so each top moves down k rows
+	// and then further only if the block it was on was removed
+	for (r = 0; r < WELL_WIDTH; r++)
+	{
+		if (g->column_top[r] == WELL_HEIGHT)
+			continue;
+		g->column_top[r] += k;
+		while (g->column_top[r] < WELL_HEIGHT && !((g->field[g->column_top[r]] >> r) & 1))
+			g->column_top[r]++;
+	}
+
+	while (k > 0)
+		g->field[--k] = 0;
+	g->completed_rows = 0;
+}
+
+/**
+ * Increases the score with a value
+ * The score digits are added to in place, so only digits that change get redrawn
+ * @param value The value to increase the score with
+ * @author Olle Jernström
+ */
+void increase_score(struct game_state *g, uint8_t value)
+{
+	uint8_t d, n;
+	uint8_t carry = 0;
+
+	g->current_score += value;
+	for (d = 6; d-- > 0 && (value || carry);)
+	{ // add digit by digit starting with the last one
+		n = g->score_digits[1][d] + value % 10 + carry;
+		value /= 10;
+		carry = n >= 10;
+		if (carry)
+			n -= 10;
+		if (n != g->score_digits[1][d])
+		{
+			g->score_digits[1][d] = n;
+			g->panel_dirty |= PANEL_DIGIT(1, d);
+		}
+	}
+}
+
+/**
+ * Updates the highscore to the current score
+ * @author Olle Jernström
+ */
+void update_highscore_to_current_score(struct game_state *g)
+{
+	uint8_t d;
+
+	g->high_score = g->current_score;
+	for (d = 0; d < 6; d++)
+	{
+		if (g->score_digits[0][d] != g->score_digits[1][d])
+		{
+			g->score_digits[0][d] = g->score_digits[1][d];
+			g->panel_dirty |= PANEL_DIGIT(0, d);
+		}
+	}
+}
+
+// ska kolla om figuren hamnar utanför spelplanen och därmed ska spelet avslutas
+uint8_t check_game_over(struct game_state *g)
+{
+	return !shape_fits(g, &shapes[g->figure_type][g->rotation], g->offset, 0);
+}
+
+/**
+ * Locks the figure where it is and scores it.
+ * Called while the figure is not on the field.
+ * @return the full rows, left on the field so they can be shown before next_figure removes them
+ */
+well_rows lock_figure(struct game_state *g)
+{
+	add_figure_to_screen_field(g);
+	raise_columns(g);
+
+	increase_score(g, 5);
+	check_if_completed_rows_exist(g);
+	return g->completed_rows;
+}
+
+/**
+ * Removes the full rows left by lock_figure, moves on to the next
+ * highscore to beat and brings in the next figure
+ * @param highscores the list the highscore to beat is taken from
+ * @return 1 if the figure does not fit, the game is over then
+ */
+uint8_t next_figure(struct game_state *g, uint32_t highscores[5][5])
+{
+	remove_checked_completed_rows(g);
+
+	// update highscore...
+	if (g->current_score > g->high_score)
+	{
+		// ... to current score if all highscores have been beaten
+		if (g->highscore_to_beat < 0)
+		{
+			update_highscore_to_current_score(g);
+		}
+		// ... next highscore to beat
+		else
+		{
+			g->highscore_to_beat--;
+			if (g->highscore_to_beat >= 0)
+				set_high_score(g, highscores[g->highscore_to_beat][4]);
+			else
+				update_highscore_to_current_score(g);
+		}
+	}
+
+	update_current_figure(g); // current becomes next
+
+	if (check_game_over(g))
+		return 1;
+
+	select_shape(g); // update next with new shape
+	update_ghost(g);
+	return 0;
+}
+
+/**
+ * Counts one game tick and speeds the game up every speed_increase_value falls
+ * @return 1 if the figure is due to fall one row
+ */
+uint8_t gravity_due(struct game_state *g)
+{
+	if (++g->time_out_counter != g->time_out_value)
+		return 0;
+	g->time_out_counter = 0;
+
+	// increase game speed if speed increase counter >= speed increase value
+	if (++g->speed_increase_counter >= g->speed_increase_value)
+	{
+		g->time_out_value = g->time_out_value == 1 ? 1 : g->time_out_value - 1;
+		g->speed_increase_counter = 0;
+	}
+	return 1;
+}
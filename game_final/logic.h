@@ -0,0 +1,23 @@
+/**
+ * Header file for logic.c
+ * The rules of the game, run on whatever game state they are handed
+ */
+void game_reset(struct game_state *g, uint32_t highscores[5][5], uint32_t seed, uint8_t mode);
+void select_shape(struct game_state *g);
+void update_current_figure(struct game_state *g);
+void add_figure_to_screen_field(struct game_state *g);
+void remove_figure_from_screen_field(struct game_state *g);
+uint8_t check_if_move_possible_down(struct game_state *g);
+uint8_t check_if_move_possible_right(struct game_state *g);
+uint8_t check_if_move_possible_left(struct game_state *g);
+uint8_t landing_row(struct game_state *g);
+void update_ghost(struct game_state *g);
+uint8_t rotate_figure(struct game_state *g);
+void check_if_completed_rows_exist(struct game_state *g);
+void remove_checked_completed_rows(struct game_state *g);
+void increase_score(struct game_state *g, uint8_t value);
+void update_highscore_to_current_score(struct game_state *g);
+uint8_t check_game_over(struct game_state *g);
+well_rows lock_figure(struct game_state *g);
+uint8_t next_figure(struct game_state *g, uint32_t highscores[5][5]);
+uint8_t gravity_due(struct game_state *g);
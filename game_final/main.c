@@ -8,6 +8,8 @@
 #include <pic32mx.h> /* Declarations of system-specific addresses etc */
 #include "display.h" /* Declarations of display specific functions */
 #include "game.h"    /* Declarations of game specific functions */
+#include "spi.h"     /* Declarations of the SPI transfer queue */
+#include "isr.h"     /* Declarations of interrupt helpers */
 
 int main(void)
 {
@@ -55,11 +57,17 @@ int main(void)
     /* SPI2CON bit ON = 1; */
     SPI2CONSET = 0x8000;
 
+    /* Interrupts, multi vector mode */
+    INTCONSET = 0x1000;
+    spi_init();
+    enable_interrupt();
+
     game_init(); // Initializes the game
 
     while (1)
     {
-        game(); // Each call to game is one frame
+        game();               // Each call to game is one frame
+        wait_for_interrupt(); // Nothing changes until an input edge or a timer wakes us
     }
 
     return 0;
@@ -0,0 +1,179 @@
+/**
+ * Frame phase profiling. Every probe reads the core timer and charges
+ * the ticks since the last probe to the phase the pass was in, so a
+ * phase can be entered many times in one pass. At the end of a pass the
+ * time of every phase that ran goes into its histogram, with 4 buckets
+ * per power of 2, which is enough to tell p50, p99 and the worst case
+ * apart. Only built with -DPROFILE, the tables take about 1 KB of RAM.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>  // Enable use of uintX_t
+#include "isr.h"     // Enable access to the core timer
+#include "clock.h"   // Enable use of CORE_TICKS_PER_US
+#include "report.h"  // Enable access to the report fields
+#include "profile.h" // Link with profile header file
+
+#ifdef PROFILE
+struct profile profile;
+
+static uint32_t frame_start; // core timer at the start of the pass
+static uint32_t last;        // core timer at the last probe
+static uint8_t current;      // phase the ticks since last belong to
+static uint8_t ran;          // phases entered this pass, one bit each
+static uint32_t spent[PROFILE_FRAME]; // ticks of each phase this pass
+
+static const char *const phase_names[PROFILE_PHASES] = {"input", "move", "animation", "clear", "field", "panel", "frame"};
+
+/**
+ * Histogram bucket of t core ticks
+ */
+static uint8_t bucket(uint32_t t)
+{
+    uint8_t msb, b;
+
+    if (t < (1 << (PROFILE_MIN_MSB + 1)))
+        return 0;
+    msb = 31 - __builtin_clz(t);
+    b = (msb - PROFILE_MIN_MSB - 1) * 4 + ((t >> (msb - 2)) & 3) + 1;
+    return b < PROFILE_BUCKETS ? b : PROFILE_BUCKETS - 1;
+}
+
+/**
+ * Largest time in core ticks that goes into bucket b
+ */
+static uint32_t bucket_top(uint8_t b)
+{
+    uint8_t msb = (b - 1) / 4 + PROFILE_MIN_MSB + 1;
+
+    if (!b)
+        return (1 << (PROFILE_MIN_MSB + 1)) - 1;
+    return ((uint32_t)(4 + (b - 1) % 4 + 1) << (msb - 2)) - 1;
+}
+
+static void record(uint8_t phase, uint32_t t)
+{
+    uint16_t *h = profile.hist[phase];
+    uint8_t b = bucket(t), i;
+
+    if (h[b] == 0xFFFF)
+        for (i = 0; i < PROFILE_BUCKETS; i++) // keep the shape, lose the oldest detail
+            h[i] >>= 1;
+    h[b]++;
+    profile.count[phase]++;
+    if (t > profile.max[phase])
+        profile.max[phase] = t;
+}
+
+/**
+ * Starts a pass, in the input phase
+ */
+void profile_frame_begin(void)
+{
+    uint8_t p;
+
+    frame_start = last = read_core_timer();
+    current = PROFILE_INPUT;
+    ran = 1 << PROFILE_INPUT;
+    for (p = 0; p < PROFILE_FRAME; p++)
+        spent[p] = 0;
+}
+
+/**
+ * Charges the ticks since the last probe to the phase the pass was in
+ * and continues in phase
+ */
+void profile_enter(uint8_t phase)
+{
+    uint32_t now = read_core_timer();
+
+    spent[current] += now - last;
+    last = now;
+    current = phase;
+    ran |= 1 << phase;
+}
+
+/**
+ * Ends a pass and puts the time of every phase that ran in its histogram
+ */
+void profile_frame_end(void)
+{
+    uint8_t p;
+
+    profile_enter(current);
+    if (ran == 1 << PROFILE_INPUT)
+    { // no input and no tick, keep these passes from drowning the rest
+        profile.idle++;
+        return;
+    }
+    for (p = 0; p < PROFILE_FRAME; p++)
+        if ((ran >> p) & 1)
+            record(p, spent[p]);
+    record(PROFILE_FRAME, last - frame_start);
+}
+
+/**
+ * Empties every histogram
+ */
+void profile_clear(void)
+{
+    uint8_t p, b;
+
+    for (p = 0; p < PROFILE_PHASES; p++)
+    {
+        for (b = 0; b < PROFILE_BUCKETS; b++)
+            profile.hist[p][b] = 0;
+        profile.count[p] = profile.max[p] = 0;
+    }
+    profile.idle = 0;
+}
+
+/**
+ * Time in core ticks below which at least per mille of the histogram of phase p lies,
+ * the top of the bucket it falls in but never above the longest time seen
+ */
+static uint32_t percentile(uint8_t p, uint16_t per_mille)
+{
+    uint32_t total = 0, seen = 0;
+    uint8_t b;
+
+    for (b = 0; b < PROFILE_BUCKETS; b++)
+        total += profile.hist[p][b];
+    for (b = 0; b < PROFILE_BUCKETS; b++)
+    {
+        seen += profile.hist[p][b];
+        if (seen * 1000 >= total * per_mille)
+            break;
+    }
+    if (b == PROFILE_BUCKETS || bucket_top(b) > profile.max[p])
+        return profile.max[p];
+    return bucket_top(b);
+}
+
+/**
+ * Hands the histograms to line one text line at a time, as p50, p99 and
+ * the longest time of every phase in microseconds
+ */
+void profile_report(void (*line)(const char *text))
+{
+    char text[64], *t;
+    uint8_t p;
+
+    line("phase        passes    p50 us    p99 us    max us");
+    for (p = 0; p < PROFILE_PHASES; p++)
+    {
+        if (!profile.count[p])
+            continue;
+        t = report_field(text, phase_names[p], 0, 9);
+        t = report_field(t, 0, profile.count[p], 10);
+        t = report_field(t, 0, percentile(p, 500) / CORE_TICKS_PER_US, 10);
+        t = report_field(t, 0, percentile(p, 990) / CORE_TICKS_PER_US, 10);
+        t = report_field(t, 0, profile.max[p] / CORE_TICKS_PER_US, 10);
+        *t = 0;
+        line(text);
+    }
+    t = report_field(text, "idle", 0, 9);
+    t = report_field(t, 0, profile.idle, 10);
+    *t = 0;
+    line(text);
+}
+#endif
@@ -0,0 +1,45 @@
+/**
+ * Header file for profile.c
+ * Core timer histograms of the phases of a game pass, built with -DPROFILE.
+ * The host build prints the report when its run ends, the board sends it
+ * at game over when also built with -DTELEMETRY, see report.c
+ */
+
+#define PROFILE_INPUT 0     // reading input events
+#define PROFILE_MOVE 1      // move checks, rotation and the rest of the game logic
+#define PROFILE_ANIMATION 2 // starting and showing animation frames
+#define PROFILE_CLEAR 3     // removing full rows, their animation included
+#define PROFILE_FIELD 4     // render_playing_field
+#define PROFILE_PANEL 5     // render_scores_and_next_figure
+#define PROFILE_FRAME 6     // the whole pass
+#define PROFILE_PHASES 7
+
+#define PROFILE_MIN_MSB 5 // every time below 2^(PROFILE_MIN_MSB + 1) core ticks shares bucket 0
+#define PROFILE_BUCKETS 72 // 4 buckets per power of 2, the last one holds everything from about 300 ms on
+
+#ifdef PROFILE
+/**
+ * Histograms of core timer ticks spent in each phase of a pass, counting
+ * only passes the phase ran in, and the longest time seen. Passes that
+ * only found no input are counted in idle, not in the histograms.
+ */
+struct profile
+{
+    uint16_t hist[PROFILE_PHASES][PROFILE_BUCKETS]; // halved for a phase when one of its buckets fills up
+    uint32_t count[PROFILE_PHASES];                 // passes counted, not halved
+    uint32_t max[PROFILE_PHASES];
+    uint32_t idle;
+};
+
+extern struct profile profile;
+
+void profile_frame_begin(void);
+void profile_enter(uint8_t phase);
+void profile_frame_end(void);
+void profile_clear(void);
+void profile_report(void (*line)(const char *text));
+#else
+#define profile_frame_begin() ((void)0)
+#define profile_enter(phase) ((void)0)
+#define profile_frame_end() ((void)0)
+#endif
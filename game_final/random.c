@@ -0,0 +1,64 @@
+/**
+ * Figure generator. A xorshift32 generator that is only ever seeded
+ * through random_seed, so a game can be played again figure by figure
+ * on the target or on the host.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h> // Enable use of uintX_t
+#include "random.h" // Link with random header file
+
+/**
+ * Next number of the xorshift32 sequence
+ */
+static uint32_t xorshift32(struct random_state *r)
+{
+    r->state ^= r->state << 13;
+    r->state ^= r->state >> 17;
+    r->state ^= r->state << 5;
+    return r->state;
+}
+
+/**
+ * Restarts a figure sequence
+ * @param seed any number, the same seed gives the same figures
+ * @param mode RANDOM_BAG or RANDOM_NO_REPEAT
+ */
+void random_seed(struct random_state *r, uint32_t seed, uint8_t mode)
+{
+    r->state = seed ? seed : 0x9E3779B9; // xorshift32 would stay at 0
+    r->mode = mode;
+    r->left = 0;
+    r->last = 7;
+}
+
+/**
+ * Returns the next figure of a sequence, 0-6
+ */
+uint8_t random_figure(struct random_state *r)
+{
+    uint8_t i, j, t;
+
+    if (r->mode == RANDOM_BAG)
+    {
+        if (r->left == 0)
+        { // refill the bag and shuffle it
+            for (i = 0; i < 7; i++)
+                r->bag[i] = i;
+            for (i = 7; i-- > 1;)
+            {
+                j = xorshift32(r) % (i + 1);
+                t = r->bag[i];
+                r->bag[i] = r->bag[j];
+                r->bag[j] = t;
+            }
+            r->left = 7;
+        }
+        r->last = r->bag[--r->left];
+    }
+    else
+    { // the figure before is replaced by the one after it
+        t = xorshift32(r) % 7;
+        r->last = t == r->last ? (t + 1) % 7 : t;
+    }
+    return r->last;
+}
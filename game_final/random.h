@@ -0,0 +1,30 @@
+/**
+ * Header file for random.c
+ * Seeded figure generator, the same seed and mode give the same figures
+ */
+
+#define RANDOM_BAG 0       // every figure once in each 7 figures, in random order
+#define RANDOM_NO_REPEAT 1 // any figure but the one before
+
+#ifndef RANDOM_MODE
+#define RANDOM_MODE RANDOM_NO_REPEAT // mode the game plays with, build with -DRANDOM_MODE to change
+#endif
+
+#ifndef RANDOM_SEED
+#define RANDOM_SEED 0 // 0 seeds every game from the start screen, build with -DRANDOM_SEED to fix it
+#endif
+
+/**
+ * State of one figure sequence, every game has its own
+ */
+struct random_state
+{
+    uint32_t state; // xorshift32 state, never 0
+    uint8_t mode;   // RANDOM_BAG or RANDOM_NO_REPEAT
+    uint8_t bag[7]; // figures left in the bag are bag[0] to bag[left - 1]
+    uint8_t left;
+    uint8_t last;   // figure returned before, 7 before the first one
+};
+
+void random_seed(struct random_state *r, uint32_t seed, uint8_t mode);
+uint8_t random_figure(struct random_state *r);
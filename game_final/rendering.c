@@ -2,489 +2,557 @@
 #include <pic32mx.h>   // Enable use of chipkit specific macros
 #include "display.h"   // Enable communication with the display
 #include "gamedata.h"  // Enable access to game data
+#include "assets.h"    // Enable access to the generated glyphs and bitmaps
+#include "arena.h"     // Enable access to the animation plane
 #include "rendering.h" // Link with rendering header file
 
 /**
- * 2D-array containing pixels of an animation
- * @author Olle Jernström
+ * Points the framebuffer cursor at column s of page c before rendering can occur
+ * NOTE: Borrowed from labs, now draws into the shadow framebuffer!
+ * @author F Lundevall & Axel Isaksson
  */
-uint8_t anim[96][32] = {};
+static void setup_screen(uint8_t c, uint8_t s)
+{
+    display_set_cursor(c, s);
+}
 
 /**
- * 2D-array containing nibbles for number rendering
+ * Draws the "press to play" text, or blank space in its place (used for blinking)
  * @author Olle Jernström
  */
-const uint8_t const numbers[10][9] = {
-    {14, 10, 10, 10, 10, 10, 10, 10, 14},
-    {4, 4, 4, 4, 4, 4, 4, 4, 4},
-    {14, 8, 8, 8, 14, 2, 2, 2, 14},
-    {14, 8, 8, 8, 14, 8, 8, 8, 14},
-    {10, 10, 10, 10, 14, 8, 8, 8, 8},
-    {14, 2, 2, 2, 14, 8, 8, 8, 14},
-    {14, 2, 2, 2, 14, 10, 10, 10, 14},
-    {14, 8, 8, 8, 8, 8, 8, 8, 8},
-    {14, 10, 10, 10, 14, 10, 10, 10, 14},
-    {14, 10, 10, 10, 14, 8, 8, 8, 14}};
+static void render_press_to_play(uint8_t b)
+{
+    uint8_t c, r; // iteration variables
+    for (c = 0; c < 4; c++)
+    {
+        setup_screen(c, 23); // after 23 rows of nothing
+        for (r = 0; r < PTP_HEIGHT; r++)
+            display_write(b ? 0 : ptp[c][r]);
+    }
+}
 
 /**
- * 2D-array containing bytes for letter rendering
+ * Renders the start screen, done once when it is shown
  * @author Olle Jernström
  */
-const uint8_t const letters[26][8] = {
-    {0x0F, 0x09, 0x09, 0x0F, 0x09, 0x09, 0x09, 4},
-    {0x07, 0x09, 0x09, 0x07, 0x09, 0x09, 0x07, 4},
-    {0x0F, 0x09, 0x01, 0x01, 0x01, 0x09, 0x0F, 4},
-    {0x07, 0x09, 0x09, 0x09, 0x09, 0x09, 0x07, 4},
-    {0x0F, 0x01, 0x01, 0x07, 0x01, 0x01, 0x0F, 4},
-    {0x0F, 0x01, 0x01, 0x07, 0x01, 0x01, 0x01, 4},
-    {0x0F, 0x09, 0x01, 0x01, 0x0D, 0x09, 0x0F, 4},
-    {0x09, 0x09, 0x09, 0x0F, 0x09, 0x09, 0x09, 4},
-    {0x1C, 0x08, 0x08, 0x08, 0x08, 0x08, 0x1C, 3},
-    {0x0E, 0x04, 0x04, 0x04, 0x04, 0x05, 0x07, 4},
-    {0x09, 0x0D, 0x05, 0x03, 0x05, 0x0D, 0x09, 4},
-    {0x01, 0x01, 0x01, 0x01, 0x01, 0x01, 0x0F, 4},
-    {0x63, 0x63, 0x55, 0x55, 0x55, 0x49, 0x49, 7},
-    {0x13, 0x13, 0x15, 0x15, 0x15, 0x19, 0x19, 5},
-    {0x06, 0x09, 0x09, 0x09, 0x09, 0x09, 0x06, 4},
-    {0x0F, 0x09, 0x09, 0x0F, 0x01, 0x01, 0x01, 4},
-    {0x06, 0x09, 0x09, 0x09, 0x0D, 0x0D, 0x16, 5},
-    {0x07, 0x09, 0x09, 0x07, 0x09, 0x09, 0x09, 4},
-    {0x0F, 0x09, 0x01, 0x0F, 0x08, 0x09, 0x0F, 4},
-    {0x1F, 0x04, 0x04, 0x04, 0x04, 0x04, 0x04, 5},
-    {0x09, 0x09, 0x09, 0x09, 0x09, 0x09, 0x0F, 4},
-    {0x11, 0x11, 0x11, 0x11, 0x0A, 0x0A, 0x04, 5},
-    {0x41, 0x41, 0x41, 0x49, 0x2A, 0x2A, 0x14, 7},
-    {0x11, 0x11, 0x0A, 0x04, 0x0A, 0x11, 0x11, 5},
-    {0x11, 0x11, 0x11, 0x1F, 0x04, 0x04, 0x04, 5},
-    {0x1F, 0x10, 0x08, 0x04, 0x02, 0x01, 0x1F, 5}};
+void render_start_screen(uint8_t b)
+{
+    uint8_t c, r; // iteration variables
+    display_stats_source(DISPLAY_SOURCE_SCREENS);
+    for (c = 0; c < 4; c++)
+    {                       // render_frame in 4 columns
+        setup_screen(c, 0); // setup display for data
+
+        for (r = 0; r < 23; r++) // start with 23 rows of nothing
+            display_write(0);
+
+        setup_screen(c, 94);     // "press to play" goes in between
+        for (r = 0; r < 23; r++) // spacing for logo
+            display_write(0);
+
+        display_write(0xFF); // bottom line for logo
+        display_write(0);
+        for (r = 0; r < LOGO_HEIGHT; r++) // logo rendering
+            display_write(logo[c][r]);
+        display_write(0);
+        display_write(0xFF); // top line for logo
+    }
+    render_press_to_play(b);
+    display_present();
+}
 
 /**
- * 2D-array containing bytes for logo rendering
+ * Blinks the "press to play" text of the start screen
  * @author Olle Jernström
  */
-const uint8_t const logo[7][4] = {
-    {0xDF, 0xFB, 0x8E, 0xF3},
-    {0x44, 0x20, 0x12, 0x91},
-    {0x44, 0x20, 0x12, 0x11},
-    {0xC4, 0x21, 0x0E, 0xF1},
-    {0x44, 0x20, 0x12, 0x81},
-    {0x44, 0x20, 0x12, 0x91},
-    {0xC4, 0x23, 0x92, 0xF3}};
+void render_start_screen_blink(uint8_t b)
+{
+    display_stats_source(DISPLAY_SOURCE_SCREENS);
+    render_press_to_play(b);
+    display_present();
+}
 
 /**
- * 2D-array containing bytes for highscore rendering
- * @author Olle Jernström
+ * Draws digit n into one nibble of page p, the bottom row of the glyph in display column col
  */
-const uint8_t const hisc[7][4] = {
-    {0x20, 0x1D, 0xB8, 0x07},
-    {0x20, 0x09, 0xA8, 0x04},
-    {0x20, 0x09, 0x88, 0x00},
-    {0xE0, 0xC9, 0xBB, 0x00},
-    {0x20, 0x09, 0xA0, 0x00},
-    {0x20, 0x09, 0xA8, 0x04},
-    {0x20, 0x1D, 0xB8, 0x07}};
+static void render_digit(uint8_t n, uint8_t p, uint8_t shift, uint8_t col)
+{
+    uint8_t i; // iteration variable
+    for (i = 0; i < NUMBERS_HEIGHT; i++, col++)
+    {
+        setup_screen(p, col);
+        display_write((display_buffer[p][col] & ~(0xF << shift)) | (numbers[n][i] << shift));
+    }
+}
 
 /**
- * 2D-array containing bytes for "press to play" rendering
- * @author Olle Jernström
+ * Draws 6 digits side by side from page p on, the bottom row of the glyphs in display column col
  */
-const uint8_t const ptp[71][4] = {
-    {0xF0, 0xCE, 0x7B, 0x0F},
-    {0x90, 0x52, 0x48, 0x09},
-    {0x90, 0x52, 0x08, 0x01},
-    {0xF0, 0xCE, 0x79, 0x0F},
-    {0x10, 0x52, 0x40, 0x08},
-    {0x10, 0x52, 0x48, 0x09},
-    {0x10, 0xD2, 0x7B, 0x0F},
-    {0x00, 0x00, 0x00, 0x00},
-    {0xE0, 0x7C, 0x53, 0x02},
-    {0x20, 0x11, 0x53, 0x02},
-    {0x20, 0x11, 0x55, 0x02},
-    {0xE0, 0x10, 0xD5, 0x03},
-    {0x20, 0x11, 0x15, 0x02},
-    {0x20, 0x11, 0x19, 0x02},
-    {0xE0, 0x10, 0x19, 0x02},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x00, 0xF8, 0x1E, 0x00},
-    {0x00, 0x20, 0x12, 0x00},
-    {0x00, 0x20, 0x12, 0x00},
-    {0x00, 0x20, 0x12, 0x00},
-    {0x00, 0x20, 0x12, 0x00},
-    {0x00, 0x20, 0x12, 0x00},
-    {0x00, 0x20, 0x1E, 0x00},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x78, 0xDF, 0x3B, 0x1F},
-    {0x48, 0x44, 0x4A, 0x04},
-    {0x08, 0x44, 0x4A, 0x04},
-    {0x78, 0xC4, 0x3B, 0x04},
-    {0x40, 0x44, 0x4A, 0x04},
-    {0x48, 0x44, 0x4A, 0x04},
-    {0x78, 0x44, 0x4A, 0x04},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x00, 0x78, 0x07, 0x00},
-    {0x00, 0x48, 0x09, 0x00},
-    {0x00, 0x48, 0x09, 0x00},
-    {0x00, 0x48, 0x07, 0x00},
-    {0x00, 0x48, 0x09, 0x00},
-    {0x00, 0x48, 0x09, 0x00},
-    {0x00, 0x78, 0x09, 0x00},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x70, 0xFE, 0xA6, 0x07},
-    {0x90, 0x10, 0x26, 0x04},
-    {0x90, 0x10, 0x2A, 0x04},
-    {0x70, 0x10, 0xAA, 0x07},
-    {0x90, 0x10, 0xAA, 0x00},
-    {0x90, 0x10, 0xB2, 0x00},
-    {0x70, 0x10, 0xB2, 0x07},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x00, 0xDE, 0x3B, 0x00},
-    {0x00, 0x42, 0x4A, 0x00},
-    {0x00, 0x42, 0x4A, 0x00},
-    {0x00, 0x4E, 0x3A, 0x00},
-    {0x00, 0x42, 0x4A, 0x00},
-    {0x00, 0x42, 0x4A, 0x00},
-    {0x00, 0xC2, 0x4B, 0x00},
-    {0x00, 0x00, 0x00, 0x00},
-    {0x90, 0xEE, 0x25, 0x00},
-    {0x90, 0x24, 0x25, 0x00},
-    {0x90, 0x24, 0x24, 0x00},
-    {0xF0, 0x24, 0xBD, 0x07},
-    {0x90, 0x24, 0x25, 0x00},
-    {0x90, 0x24, 0x25, 0x00},
-    {0x90, 0xEE, 0x25, 0x00},
-    {0x00, 0x00, 0x00, 0x00},
-    {0xF0, 0xDE, 0x3B, 0x0F},
-    {0x90, 0x52, 0x4A, 0x01},
-    {0x10, 0x42, 0x4A, 0x01},
-    {0xF0, 0x42, 0x3A, 0x07},
-    {0x80, 0x42, 0x4A, 0x01},
-    {0x90, 0x52, 0x4A, 0x01},
-    {0xF0, 0xDE, 0x4B, 0x0F}};
+static void render_digits(const uint8_t digits[6], uint8_t p, uint8_t col)
+{
+    uint8_t d; // iteration variable
+    for (d = 0; d < 6; d++)
+        render_digit(digits[d], p + d / 2, (d & 1) * 4, col);
+}
 
 /**
- * Sets up the display with neccessary commands before rendering can occur
- * NOTE: Borrowed from labs!
- * @author F Lundevall & Axel Isaksson
+ * Draws the highscore and score text and digits in the 19 columns from col on
  */
-static void setup_screen(uint8_t c, uint8_t s)
+static void render_score_lines(struct game_state *g, uint8_t col)
 {
-    PORTFCLR = 0x10;
-    spi_send_recv(0x22);
-    spi_send_recv(c);
-    spi_send_recv(s & 0xF);
-    spi_send_recv(0x10 | ((s >> 4) & 0xF));
-    PORTFSET = 0x10;
+    uint8_t c, r; // iteration variables
+    for (c = 0; c < 4; c++)
+    {
+        setup_screen(c, col);
+        for (r = 0; r < SCORE_LABELS_HEIGHT; r++)
+            display_write(c == 0 ? score_labels[0][r] : 0);
+    }
+    render_digits(g->score_digits[1], 1, col);
+    render_digits(g->score_digits[0], 1, col + 10);
 }
 
 /**
- * Renders the start screen
+ * Renders the parts of the highscore, score and next figure marked in panel_dirty
  * @author Olle Jernström
  */
-void render_start_screen(uint8_t b, uint8_t cv)
+void render_scores_and_next_figure(struct game_state *g)
 {
-    uint8_t c, r; // iteration variables
-    for (c = 0; c < 4; c++)
-    {                       // render_frame in 4 columns
-        setup_screen(c, 0); // setup display for data
+    uint8_t c, rn, h, cb, nb, i, row; // function variables
+    display_stats_source(DISPLAY_SOURCE_PANEL);
 
-        for (r = 0; r < 23; r++) // start with 23 rows of nothing
-            spi_send_recv(0);
+    if (g->panel_dirty & PANEL_DIRTY_FRAME)
+    {
+        for (c = 0; c < 4; c++)
+        {                        // render_frame in 4 columns
+            setup_screen(c, 96); // setup display for data
 
-        if (b) // whether the "press to play" text should be rendered or not (used for blinking)
-            for (r = 0; r < 71; r++)
-                spi_send_recv(0);
-        else
-            for (r = 71; r-- > 0;)
-                spi_send_recv(ptp[r][c]);
+            // renders next figure frame
+            display_write(0xFF);
+            for (i = 0; i < 10; i++)
+                display_write(c == 0 ? 1 : c == 3 ? 0x80 : 0);
+            display_write(0xFF);
+            display_write(0);
+        }
+        render_score_lines(g, 109); // renders score and highscore
+        g->panel_dirty = PANEL_DIRTY_NEXT;
+    }
 
-        for (r = 0; r < 23; r++) // spacing for logo
-            spi_send_recv(0);
-
-        spi_send_recv(0xFF); // bottom line for logo
-        spi_send_recv(0);
-        for (r = 7; r-- > 0;) // logo rendering
-            spi_send_recv(logo[r][c]);
-        spi_send_recv(0);
-        spi_send_recv(0xFF); // top line for logo
+    if (g->panel_dirty & PANEL_DIRTY_NEXT)
+    {
+        for (c = 1; c < 3; c++)
+        {                        // the figure is in the 2 middle columns
+            setup_screen(c, 98); // inside the frame
+            for (rn = 2; rn-- > 0;)
+            {
+                row = SHAPE_ROW(shapes[g->next_figure_type][0].mask, rn) >> (c * 2 - 2);
+                cb = row & 1;
+                nb = (row >> 1) & 1;
+                for (h = 0; h < 4; h++)
+                    display_write((cb * 0xF) | (nb * 0xF0));
+            }
+        }
     }
+
+    for (i = 0; i < 12; i++) // digits that changed, the score is shown below the highscore
+        if (g->panel_dirty & (1 << i))
+            render_digit(g->score_digits[i / 6][i % 6], 1 + (i % 6) / 2, (i & 1) * 4, i < 6 ? 119 : 109);
+
+    g->panel_dirty = 0;
+    display_present();
+}
+
+/*
+ * Cell expansion tables for the cell size the game is built with, entry n
+ * is the 4 cells of n spread to WELL_CELL pixels each. solid fills a whole
+ * cell, outline only its outer pixels, which is what the middle pixel rows
+ * of a ghost cell are drawn with. A 2 pixel cell has no middle and its
+ * outline would be the whole cell, so its ghost is a checker instead, one
+ * pixel of each cell on either pixel row. Turning a row of cells into a
+ * row of pixels is a lookup per 4 cells instead of a loop over pixels.
+ */
+#define CELL_SPREAD(n, p) (((n) & 1) * (p) | ((n) >> 1 & 1) * (p) << WELL_CELL | \
+                           ((n) >> 2 & 1) * (p) << 2 * WELL_CELL | ((n) >> 3 & 1) * (p) << 3 * WELL_CELL)
+#define CELL_TABLE(p) {CELL_SPREAD(0, p), CELL_SPREAD(1, p), CELL_SPREAD(2, p), CELL_SPREAD(3, p),     \
+                       CELL_SPREAD(4, p), CELL_SPREAD(5, p), CELL_SPREAD(6, p), CELL_SPREAD(7, p),     \
+                       CELL_SPREAD(8, p), CELL_SPREAD(9, p), CELL_SPREAD(10, p), CELL_SPREAD(11, p),   \
+                       CELL_SPREAD(12, p), CELL_SPREAD(13, p), CELL_SPREAD(14, p), CELL_SPREAD(15, p)}
+
+#define CELL_PIXELS ((1 << WELL_CELL) - 1)           // one cell, all of it
+#define CELL_EDGES (1 | 1 << (WELL_CELL - 1))        // one cell, its outer pixels
+#define WELL_MASK ((uint32_t)((1ULL << (WELL_WIDTH * WELL_CELL)) - 1) << WELL_LEFT) // pixel columns of the well
+#define WELL_WALLS ((WELL_LEFT ? (uint32_t)1 << (WELL_LEFT - 1) : 0) | (WELL_LEFT + WELL_WIDTH * WELL_CELL < 32 ? WELL_MASK << 1 & ~WELL_MASK : 0))
+
+static const uint16_t cell_solid[16] = CELL_TABLE(CELL_PIXELS);
+#if WELL_CELL > 2
+static const uint16_t cell_outline[16] = CELL_TABLE(CELL_EDGES);
+#else
+static const uint16_t cell_checker[2][16] = {CELL_TABLE(1), CELL_TABLE(2)};
+#endif
+
+/**
+ * Spreads a row of cells to pixel columns with one of the cell tables
+ */
+static uint32_t cell_spread(well_row cells, const uint16_t table[16])
+{
+    uint32_t px = 0;
+    uint8_t i;
+
+    for (i = 0; i < WELL_WIDTH; i += 4)
+        px |= (uint32_t)table[(cells >> i) & 0xF] << (i * WELL_CELL);
+    return px << WELL_LEFT;
+}
+
+/**
+ * The pixel rows of field row r: px[0] for the first pixel row of its
+ * cells, px[2] for the last and px[1] for the ones between
+ */
+static void cell_rows(struct game_state *g, uint8_t r, uint32_t px[3])
+{
+    uint32_t solid = cell_spread(g->field[r], cell_solid) | WELL_WALLS;
+
+#if WELL_CELL > 2
+    px[0] = px[2] = solid | cell_spread(g->ghost[r], cell_solid);
+    px[1] = solid | cell_spread(g->ghost[r], cell_outline);
+#else
+    px[0] = px[1] = solid | cell_spread(g->ghost[r], cell_checker[0]);
+    px[2] = solid | cell_spread(g->ghost[r], cell_checker[1]);
+#endif
 }
 
 /**
- * Updates the scores 2D array with a given score
- * Updates score part if high_score = 0, else highscore
+ * Converts the playing field data to the 1-bit animation plane
  * @author Olle Jernström
  */
-void update_scores(const uint32_t current_score, const uint8_t high_score)
+static void animation_setup_pixel_by_pixel(struct game_state *g)
 {
-    uint32_t tmp_sc = current_score; // temporary score
-    uint8_t d, i, n;                 // iteration variables
-    uint8_t s = high_score ? 0 : 10; // s keeps track of where the new score should be put
-
-    for (d = 8; d-- > 2;)
-    {                           // loop through every digit
-        n = tmp_sc % 10;        // n becomes last digit
-        for (i = 0; i < 9; i++) // update correct digit in scores
-            scores[s + i][d] = numbers[n][i];
-        tmp_sc /= 10; // divide away last digit
+    uint32_t *anim = arena.play.anim;
+    uint8_t r, h;
+    uint32_t px[3];
+
+    for (r = 0; r < WELL_HEIGHT; r++)
+    {
+        cell_rows(g, r, px);
+        anim[r * WELL_CELL] = px[0];
+        for (h = 1; h < WELL_CELL - 1; h++)
+            anim[r * WELL_CELL + h] = px[1];
+        anim[r * WELL_CELL + WELL_CELL - 1] = px[2];
     }
 }
 
 /**
- * Renders the highscore, score and next figure
- * @author Olle Jernström
+ * Returns a mask of pixel columns first to last
  */
-void render_scores_and_next_figure(void)
+static uint32_t pixel_span(uint8_t first, uint8_t last)
 {
-    uint8_t c, rn, rs, h, cb, nb, i; // function variables
-    for (c = 0; c < 4; c++)
-    {                        // render_frame in 4 columns
-        setup_screen(c, 96); // setup display for data
+    uint32_t m = last >= 31 ? 0xFFFFFFFF : ((uint32_t)1 << (last + 1)) - 1;
+    return m & ~(((uint32_t)1 << first) - 1);
+}
 
-        // renders next figure
-        spi_send_recv(0xFF);
-        if (c == 0)
-            for (i = 0; i < 10; i++)
-                spi_send_recv(1);
-        else if (c == 3)
-            for (i = 0; i < 10; i++)
-                spi_send_recv(0x80);
-        else
-        {
-            spi_send_recv(0);
-            for (rn = 2; rn-- > 0;)
-            {
-                cb = next[rn][c * c - c];
-                nb = next[rn][c * c - c + 1];
-                for (h = 0; h < 4; h++)
-                    spi_send_recv((cb * 0xF) | (nb * 0xF0));
-            }
-            spi_send_recv(0);
-        }
-        spi_send_recv(0xFF);
-        spi_send_recv(0);
+/**
+ * The animation playing, it lives in the play arena next to its plane
+ * so it ends when another mode claims the arena
+ */
+static struct animation *const animation = &arena.play.animation;
 
-        // renders score and highscore
-        for (rs = 19; rs-- > 0;)
-            spi_send_recv(scores[rs][2 * c] | ((scores[rs][2 * c + 1] << 4) & 0xF0));
+/**
+ * Renders the part of the animation plane around the moving block, one block of
+ * margin on each side, and sends only that window to the display
+ * @author Olle Jernström
+ */
+static void render_animation()
+{
+    const uint32_t *anim = arena.play.anim;
+    uint8_t c, r;         // function variables
+    uint8_t r0, r1;       // pixel rows to render, r0 inclusive r1 exclusive
+    uint8_t p0, p1, x1;   // pages to render and last pixel column + 1
+
+    r0 = animation->top > 0 ? (animation->top - 1) * WELL_CELL : 0;
+    r1 = animation->bot < WELL_HEIGHT ? (animation->bot + 1) * WELL_CELL : WELL_PIXELS;
+    p0 = animation->lft > 0 ? (WELL_LEFT + (animation->lft - 1) * WELL_CELL) / 8 : 0;
+    x1 = animation->rgt < WELL_WIDTH ? WELL_LEFT + (animation->rgt + 1) * WELL_CELL : 32;
+    p1 = (x1 - 1) / 8;
+    display_stats_source(DISPLAY_SOURCE_ANIMATION);
+
+    for (c = p0; c <= p1; c++)
+    {                               // render_frame the covered columns
+        setup_screen(c, 96 - r1);   // row r is shown in display column 95 - r
+        for (r = r1; r-- > r0;)     // current row, byte c of it is this page
+            display_write(anim[r] >> (c * 8));
     }
+    display_present_window(p0, p1, 96 - r1, 95 - r0);
 }
 
 /**
- * Converts the playing field data to pixel by pixel data for animation
+ * Moves the animated block one more pixel, anim_ctrl is the pixel offset it reaches
  * @author Olle Jernström
  */
-static void animation_setup_pixel_by_pixel()
+static void animation_shift(uint8_t anim_ctrl)
 {
-    uint8_t r, c;
-    for (r = 0; r < 96; r++)
-        for (c = 0; c < 32; c++)
-            anim[r][c] = field[r / 4][c / 4];
+    uint32_t *anim = arena.play.anim;
+    uint8_t r;  // iteration variable
+    uint32_t m; // pixel columns that move
+    uint8_t top = animation->top * WELL_CELL, bot = animation->bot * WELL_CELL;
+    uint8_t lft = WELL_LEFT + animation->lft * WELL_CELL, rgt = WELL_LEFT + animation->rgt * WELL_CELL;
+
+    if (animation->a == 0)
+    { // down animation
+        m = pixel_span(lft, rgt - 1);
+        for (r = bot + anim_ctrl - 1; r > top + anim_ctrl - 1; r--)
+            anim[r] = (anim[r] & ~m) | (anim[r - 1] & m); // shift the animated block down
+        anim[top + anim_ctrl - 1] &= ~m;                     // set top row to be 0
+    }
+    else if (animation->a == 1)
+    { // right animation
+        m = pixel_span(lft + anim_ctrl - 1, rgt + anim_ctrl - 2);
+        for (r = top; r < bot; r++) // shift the animated block to the right, leaving 0 behind
+            anim[r] = (anim[r] & ~(m | m << 1)) | ((anim[r] & m) << 1);
+    }
+    else if (animation->a == 2)
+    { // left animation
+        m = pixel_span(lft - anim_ctrl + 1, rgt - anim_ctrl);
+        for (r = top; r < bot; r++) // shift the animated block to the left, leaving 0 behind
+            anim[r] = (anim[r] & ~(m | m >> 1)) | ((anim[r] & m) >> 1);
+    }
+    else if (animation->a == 3)
+    { // clear animation, the full rows are blank on odd frames and lit on even ones
+        for (r = top; r < bot; r++)
+            if ((animation->rows >> (r / WELL_CELL)) & 1)
+                anim[r] = anim_ctrl & 1 ? WELL_WALLS : WELL_WALLS | WELL_MASK;
+    }
 }
 
 /**
- * Renders the animation based on the animation 2D-array
+ * Starts an animation from what the field holds now, cutting short any animation playing
  * @author Olle Jernström
  */
-static void render_animation()
+static void render_animation_control(struct game_state *g, uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt, uint8_t a)
 {
-    uint8_t c, r, i, data; // function variables
-
-    for (c = 0; c < 4; c++)
-    {                       // render_frame in 4 columns
-        setup_screen(c, 0); // setup display for data
-
-        for (r = 96; r-- > 0;)
-        {                           // current row
-            data = 0;               // make sure data is 0
-            for (i = 0; i < 8; i++) // send pixels in the correct order
-                data |= (anim[r][c * 8 + i] << i);
-            spi_send_recv(data);
-        }
-    }
+    animation->top = top;
+    animation->bot = bot;
+    animation->lft = lft;
+    animation->rgt = rgt;
+    animation->a = a;
+    animation->frames = a == 3 ? 4 : WELL_CELL; // a move takes a frame per pixel, rows always flash twice
+    animation->frame = 0;
+    animation->active = 1;
+    animation->game = g;
+
+    animation_setup_pixel_by_pixel(g);
+    animation_shift(1); // the screen already shows offset 0
 }
 
 /**
- * Controls which animation should be played
+ * Shows the next animation frame, the last frame is the playing field itself.
+ * Called once per animation timer tick so frames come at a fixed cadence.
  * @author Olle Jernström
  */
-static void render_animation_control(uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt, uint8_t a)
+void animation_tick(void)
 {
-    uint8_t r, c;          // iteration variables
-    uint8_t anim_ctrl = 0; // controls which frame of the animation should be played
-    animation_setup_pixel_by_pixel();
+    if (!animation->active)
+        return;
+
+    if (++animation->frame == animation->frames)
+    {
+        animation->active = 0;
+        render_playing_field(animation->game);
+        return;
+    }
 
-    while (anim_ctrl++ < 4)
-    { // 4 frames
-        render_animation();
+    render_animation();
+    if (animation->frame < animation->frames - 1)
+        animation_shift(animation->frame + 1);
+}
 
-        if (a == 0)
-        { // down animation
-            for (c = lft * 4; c < rgt * 4; c++)
-            {
-                for (r = bot * 4 + anim_ctrl - 1; r-- > top * 4 + anim_ctrl;)
-                    anim[r + 1][c] = anim[r][c];      // shift the animated block down
-                anim[top * 4 + anim_ctrl - 1][c] = 0; // set top row to be 0
-            }
-        }
-        else if (a == 1)
-        { // right animation
-            for (r = top * 4; r < bot * 4; r++)
-            {
-                for (c = rgt * 4 + anim_ctrl - 1; c-- > lft * 4 + anim_ctrl;)
-                {
-                    anim[r][c + 1] = anim[r][c];          // shift the animated block to the right
-                    anim[r][lft * 4 + anim_ctrl - 1] = 0; // set left row to be 0
-                }
-            }
-        }
-        else if (a == 2)
-        { // left animation
-            for (r = top * 4; r < bot * 4; r++)
-            {
-                for (c = lft * 4 - anim_ctrl + 1; c < rgt * 4 - 1 + anim_ctrl - 1; c++)
-                {
-                    anim[r][c - 1] = anim[r][c];              // shift the animated block to the left
-                    anim[r][rgt * 4 - 1 + anim_ctrl - 1] = 0; // set right row to be 0
-                }
-            }
-        }
-        sleep(50000); // delay between frames
-    }
+/**
+ * Whether an animation is still playing
+ */
+uint8_t animation_playing(void)
+{
+    return animation->active;
 }
 
 /**
- * Sends the correct control signal to render_animation_control to render_frame the down animation
+ * Drops the animation playing, the caller renders what should be shown instead
+ */
+void animation_stop(void)
+{
+    animation->active = 0;
+}
+
+/**
+ * Starts the down animation
  * @author Olle Jernström
  */
-void render_animation_down(uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
+void render_animation_down(struct game_state *g, uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
 {
-    render_animation_control(top, bot, lft, rgt, 0);
+    render_animation_control(g, top, bot, lft, rgt, 0);
 }
 
 /**
- * Sends the correct control signal to render_animation_control to render_frame the right animation
+ * Starts the right animation
  * @author Olle Jernström
  */
-void render_animation_right(uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
+void render_animation_right(struct game_state *g, uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
 {
-    render_animation_control(top, bot, lft, rgt, 1);
+    render_animation_control(g, top, bot, lft, rgt, 1);
 }
 
 /**
- * Sends the correct control signal to render_animation_control to render_frame the left animation
+ * Starts the left animation
  * @author Olle Jernström
  */
-void render_animation_left(uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
+void render_animation_left(struct game_state *g, uint8_t top, uint8_t bot, uint8_t lft, uint8_t rgt)
 {
-    render_animation_control(top, bot, lft, rgt, 2);
+    render_animation_control(g, top, bot, lft, rgt, 2);
 }
 
-void render_animation_slam()
+/**
+ * Starts the clear animation: the full rows flash and the last frame shows
+ * the field the game has already compacted, whatever the number of rows
+ * @param rows bit r is set if row r is full
+ */
+void render_animation_clear(struct game_state *g, well_rows rows)
 {
+    uint8_t top = 0, bot = WELL_HEIGHT;
+    while (!((rows >> top) & 1))
+        top++;
+    while (!((rows >> (bot - 1)) & 1))
+        bot--;
+    animation->rows = rows;
+    render_animation_control(g, top, bot, 0, WELL_WIDTH, 3);
 }
 
 /**
- * Renders the playing field
+ * Renders the playing field, unless an animation is still drawing it
  * @author Olle Jernström
  */
-void render_playing_field(void)
+void render_playing_field(struct game_state *g)
 {
-    uint8_t c, r, h, cb, nb; // function definitions
-    for (c = 0; c < 4; c++)
-    {                       // render_frame in 4 columns
-        setup_screen(c, 0); // setup display for data
-
-        for (r = 24; r-- > 0;)
-        {                             // current row
-            cb = field[r][2 * c];     // current block
-            nb = field[r][2 * c + 1]; // next block (right)
-            for (h = 0; h < 4; h++)   // block height
-                spi_send_recv((cb * 0xF) | (nb * 0xF0));
+    uint8_t c, r, h; // function definitions
+    uint32_t px[3];
+    if (animation->active)
+        return; // the last animation frame renders the field
+    display_stats_source(DISPLAY_SOURCE_FIELD);
+    for (r = 0; r < WELL_HEIGHT; r++)
+    { // every row once, written to all 4 pages
+        cell_rows(g, r, px);
+        for (c = 0; c < 4; c++)
+        { // pixel row p is shown in display column 95 - p, so the last one comes first
+            setup_screen(c, 96 - (r + 1) * WELL_CELL);
+            display_write(px[2] >> (c * 8));
+            for (h = 1; h < WELL_CELL - 1; h++)
+                display_write(px[1] >> (c * 8));
+            display_write(px[0] >> (c * 8));
         }
     }
+    for (c = 0; c < 4 && WELL_PIXELS < 96; c++)
+    { // the floor, and nothing under it
+        setup_screen(c, 0);
+        for (r = WELL_PIXELS + 1; r < 96; r++)
+            display_write(0);
+        display_write((WELL_MASK | WELL_WALLS) >> (c * 8));
+    }
+    display_present();
+}
+
+/**
+ * Draws letter c of the name and the line under it if it is the selected one
+ * @author Olle Jernström
+ */
+static void render_name_letter(uint8_t sl[4], uint8_t c, uint8_t lc)
+{
+    uint8_t r; // iteration variable
+
+    setup_screen(c, 59);
+    display_write(c == lc ? letters[sl[c]][LETTERS_HEIGHT] : 0); // line as wide as the selected letter
+    display_write(0);
+
+    for (r = 0; r < LETTERS_HEIGHT; r++) // render_frame selected letter
+        display_write(letters[sl[c]][r]);
 }
 
 /**
- * Renders the name selection menu for new highscore
+ * Renders the name selection menu for new highscore, done once when it is shown
  * @author Olle Jernström
  */
-void render_name_selection_for_new_highscore(uint8_t sl[4], uint8_t lc)
+void render_name_selection_for_new_highscore(struct game_state *g, uint8_t sl[4], uint8_t lc)
 {
-    uint8_t c, r, rs; // iteration variables
+    uint8_t c, r; // iteration variables
 
+    display_stats_source(DISPLAY_SOURCE_SCREENS);
     for (c = 0; c < 4; c++)
     {                            // render_frame in 4 columns
         setup_screen(c, 0);      // setup display for data
         for (r = 0; r < 59; r++) // spacing
-            spi_send_recv(0);
-
-        if (c == lc)
-        { // renders correct line under selected letter
-            if (letters[sl[c]][7] == 3)
-                spi_send_recv(0x1C);
-            else if (letters[sl[c]][7] == 4)
-                spi_send_recv(0x0F);
-            else if (letters[sl[c]][7] == 5)
-                spi_send_recv(0x1F);
-            else if (letters[sl[c]][7] == 7)
-                spi_send_recv(0x7F);
-        }
-        else
-            spi_send_recv(0);
-        spi_send_recv(0);
+            display_write(0);
 
-        for (r = 7; r-- > 0;) // render_frame selected letter
-            spi_send_recv(letters[sl[c]][r]);
+        render_name_letter(sl, c, lc);
 
         for (r = 0; r < 10; r++) // spacing
-            spi_send_recv(0);
-
-        for (rs = 19; rs-- > 0;)
-            spi_send_recv(scores[rs][2 * c] | ((scores[rs][2 * c + 1] << 4) & 0xF0));
+            display_write(0);
 
+        setup_screen(c, 97);               // after the scores
         for (r = 0; r < 60 - 19 - 10; r++) // spacing
-            spi_send_recv(0);
+            display_write(0);
     }
+    render_score_lines(g, 78);
+    display_present();
 }
 
 /**
- * Renders the highscore list
+ * Redraws letter c of the name selection after it or the selection changed
  * @author Olle Jernström
  */
-void render_highscores(uint32_t sl[5][5])
+void render_name_selection_update(uint8_t sl[4], uint8_t c, uint8_t lc)
 {
-    uint8_t c, r, s, sr; // function variables
-    for (c = 0; c < 4; c++)
-    {                       // render_frame in 4 columns
-        setup_screen(c, 0); // setup display for data
-
-        for (s = 5; s-- > 0;)
-        {                               // which score to render_frame
-            update_scores(sl[s][4], 0); // update the score in the scores 2D-array to use its numbers
-            for (sr = 19; sr-- > 9;)
-            {               // row in scores
-                if (c != 3) // render_frame score for the first 3 columns
-                    spi_send_recv(scores[sr][2 * (c + 1)] | ((scores[sr][2 * (c + 1) + 1] << 4) & 0xF0));
-                else
-                    spi_send_recv(0);
-            }
-            spi_send_recv(0);
+    display_stats_source(DISPLAY_SOURCE_SCREENS);
+    render_name_letter(sl, c, lc);
+    display_present();
+}
 
-            for (r = 7; r-- > 0;) // render_frame the name of current score holder
-                spi_send_recv(letters[sl[s][c]][r]);
+/**
+ * Renders the highscore list, done once when it is shown
+ * @author Olle Jernström
+ */
+void render_highscores(uint32_t sl[5][5])
+{
+    uint8_t c, r, s, d;  // function variables
+    uint8_t digits[6];   // digits of the score being rendered
+    uint32_t sc;         // what is left of the score to format
+
+    display_stats_source(DISPLAY_SOURCE_HIGHSCORES);
+    for (s = 5; s-- > 0;)
+    {                   // which score to render_frame
+        for (c = 0; c < 4; c++)
+        {                                   // render_frame in 4 columns
+            setup_screen(c, (4 - s) * 23); // every score takes 23 rows
+            for (r = 0; r < 11; r++)        // room for the score
+                display_write(0);
+
+            for (r = 0; r < LETTERS_HEIGHT; r++) // render_frame the name of current score holder
+                display_write(letters[sl[s][c]][r]);
 
             for (r = 0; r < 5; r++)
-                spi_send_recv(0);
+                display_write(0);
         }
 
-        // render_frame highscore text
-        spi_send_recv(0);
-        spi_send_recv(0);
-        spi_send_recv(0xFF);
-        spi_send_recv(0);
-        for (r = 7; r-- > 0;)
-            spi_send_recv(hisc[r][c]);
-        spi_send_recv(0);
-        spi_send_recv(0xFF);
+        sc = sl[s][4];
+        for (d = 6; d-- > 0; sc /= 10) // formatted once, not once per column
+            digits[d] = sc % 10;
+        render_digits(digits, 0, (4 - s) * 23); // render_frame score in the first 3 columns
+    }
+
+    for (c = 0; c < 4; c++)
+    {                         // render_frame highscore text
+        setup_screen(c, 115); // below the 5 scores
+        display_write(0);
+        display_write(0);
+        display_write(0xFF);
+        display_write(0);
+        for (r = 0; r < HISC_HEIGHT; r++)
+            display_write(hisc[c][r]);
+        display_write(0);
+        display_write(0xFF);
     }
+    display_present();
 }
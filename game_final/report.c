@@ -0,0 +1,70 @@
+/**
+ * Debug reports. The display traffic report of a -DDISPLAY_STATS build
+ * and the frame phase histograms of a -DPROFILE build are tables laid
+ * out with report_field and written one text line at a time to a line
+ * sink, the same one for both. The host build prints them when its run
+ * ends. The board has no console, so there they go out on the telemetry
+ * channel as text records and tools/teledec prints them. The game sends
+ * them at game over, while the last field is shown, so waiting for the
+ * UART costs no game time. On the board they are only sent when built
+ * with -DTELEMETRY as well.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>    // Enable use of uintX_t
+#include "gamedata.h"  // Enable access to the well size
+#include "display.h"   // Enable access to the display traffic report
+#include "profile.h"   // Enable access to the frame phase report
+#include "telemetry.h" // Enable access to the text records
+#include "report.h"    // Link with report header file
+
+#if defined(DISPLAY_STATS) || defined(PROFILE)
+/**
+ * Writes text, or the number n when text is 0, right aligned in width
+ * characters for a column of a report line
+ * @return where the next field goes
+ */
+char *report_field(char *out, const char *text, uint32_t n, uint8_t width)
+{
+    char digits[11];
+    uint8_t len = 0;
+
+    if (!text)
+    {
+        do
+            digits[len++] = '0' + n % 10;
+        while (n /= 10);
+    }
+    else
+        while (text[len])
+            len++;
+
+    while (width-- > len)
+        *out++ = ' ';
+    while (len--)
+        *out++ = text ? *text++ : digits[len];
+    return out;
+}
+
+/**
+ * Hands every report the build has to line, the counts since power up
+ */
+void report_write(void (*line)(const char *text))
+{
+#ifdef DISPLAY_STATS
+    display_stats_report(line);
+#endif
+#ifdef PROFILE
+    profile_report(line);
+#endif
+}
+#endif
+
+#if defined(TELEMETRY) && (defined(DISPLAY_STATS) || defined(PROFILE))
+/**
+ * Sends the reports on UART1
+ */
+void report_send(void)
+{
+    report_write(telemetry_text);
+}
+#endif
@@ -0,0 +1,15 @@
+/**
+ * Header file for report.c
+ * The debug reports, written to any line sink and sent on the board
+ */
+
+#if defined(DISPLAY_STATS) || defined(PROFILE)
+char *report_field(char *out, const char *text, uint32_t n, uint8_t width);
+void report_write(void (*line)(const char *text));
+#endif
+
+#if defined(TELEMETRY) && (defined(DISPLAY_STATS) || defined(PROFILE))
+void report_send(void);
+#else
+#define report_send() ((void)0)
+#endif
@@ -0,0 +1,166 @@
+/**
+ * Interrupt driven transfer queue for the OLED on SPI2.
+ * Callers queue command and data segments, the SPI2 receive interrupt
+ * feeds the peripheral one byte at a time and switches the D/C line on
+ * PORTF between segments, so the game keeps running during a transfer.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable use of chipkit specific macros
+#include "spi.h"     // Link with spi header file
+
+#define SPI_QUEUE_BYTES 1088 // room for two full frames with their window commands
+#define SPI_SEGMENT_MAX 128  // longest segment a header byte can describe
+
+/* queue:
+   Ring of segments. Every segment starts with a header byte holding
+   the D/C level in bit 7 and the length minus one in bits 0-6. */
+static uint8_t queue[SPI_QUEUE_BYTES];
+static volatile uint16_t queue_head; // end of the last whole segment, only moved by spi_queue
+static volatile uint16_t queue_tail; // next byte to send, only moved by the interrupt
+
+static volatile uint8_t busy;      // a byte is on its way out
+static uint8_t segment_left;       // bytes left of the segment being sent
+static uint32_t queued;            // ring bytes ever queued
+static uint32_t consumed;          // ring bytes ever taken by spi_next
+static volatile uint32_t finished; // ring bytes whose data has left SPI2
+
+/**
+ * Configures the SPI2 receive interrupt, the peripheral itself is set up in main
+ */
+void spi_init(void)
+{
+    IECCLR(1) = SPI2_RX_IRQ;
+    IFSCLR(1) = SPI2_RX_IRQ;
+    IPCCLR(7) = 0x1F << 24; // clear SPI2 priority and subpriority
+    IPCSET(7) = 1 << 26;    // SPI2 priority 1
+}
+
+/**
+ * Puts the next queued byte in SPI2BUF, switching D/C at segment starts.
+ * Must run with the SPI2 interrupt masked or from the interrupt itself.
+ */
+static void spi_next(void)
+{
+    uint8_t header;
+
+    if (queue_tail == queue_head)
+    { // nothing left, go idle until spi_queue kicks us again
+        busy = 0;
+        IECCLR(1) = SPI2_RX_IRQ;
+        return;
+    }
+
+    if (!segment_left)
+    {
+        header = queue[queue_tail];
+        queue_tail = queue_tail + 1 == SPI_QUEUE_BYTES ? 0 : queue_tail + 1;
+        consumed++;
+        segment_left = (header & 0x7F) + 1;
+        if (header & 0x80)
+            PORTFSET = 0x10; // data mode
+        else
+            PORTFCLR = 0x10; // command mode
+    }
+
+    SPI2BUF = queue[queue_tail];
+    queue_tail = queue_tail + 1 == SPI_QUEUE_BYTES ? 0 : queue_tail + 1;
+    consumed++;
+    segment_left--;
+}
+
+/**
+ * Called from the interrupt handler when SPI2 has shifted out a byte
+ */
+void spi_service(void)
+{
+    (void)SPI2BUF; // empty the receive buffer
+    IFSCLR(1) = SPI2_RX_IRQ;
+    finished = consumed; // only one byte is ever in flight
+    spi_next();
+}
+
+/**
+ * Starts the transfer if the engine is idle
+ */
+static void spi_kick(void)
+{
+    IECCLR(1) = SPI2_RX_IRQ;
+    if (busy)
+    {
+        IECSET(1) = SPI2_RX_IRQ;
+        return;
+    }
+    if (queue_tail != queue_head)
+    {
+        busy = 1;
+        IFSCLR(1) = SPI2_RX_IRQ;
+        spi_next();
+        IECSET(1) = SPI2_RX_IRQ;
+    }
+}
+
+/**
+ * Bytes the ring can take without overwriting what the interrupt has yet to send
+ */
+static uint16_t spi_room(void)
+{
+    int16_t room = queue_tail - queue_head - 1;
+    return room < 0 ? room + SPI_QUEUE_BYTES : room;
+}
+
+/**
+ * Queues len bytes to be sent with the D/C line at dc and starts sending.
+ * The bytes are copied, so the caller may reuse data right away.
+ * Every segment is written in full before queue_head is moved past it,
+ * so the interrupt never sees a header without its data.
+ */
+void spi_queue(const uint8_t *data, uint16_t len, uint8_t dc)
+{
+    uint16_t h;
+    uint8_t n, i;
+
+    while (len)
+    {
+        n = len > SPI_SEGMENT_MAX ? SPI_SEGMENT_MAX : len;
+        while (spi_room() < n + 1)
+            spi_kick(); // ring full, let the interrupt drain it
+
+        h = queue_head;
+        queue[h] = (dc ? 0x80 : 0) | (n - 1);
+        for (i = 0; i < n; i++)
+        {
+            h = h + 1 == SPI_QUEUE_BYTES ? 0 : h + 1;
+            queue[h] = *data++;
+        }
+        queue_head = h + 1 == SPI_QUEUE_BYTES ? 0 : h + 1; // the whole segment at once
+        queued += n + 1;
+        len -= n;
+    }
+    spi_kick();
+}
+
+/**
+ * Returns a ticket that is done once everything queued so far has been sent
+ */
+uint32_t spi_ticket(void)
+{
+    return queued;
+}
+
+/**
+ * Completion flag for a ticket from spi_ticket
+ */
+uint8_t spi_done(uint32_t ticket)
+{
+    return (int32_t)(finished - ticket) >= 0;
+}
+
+/**
+ * Waits until the queue is empty and the last byte has left SPI2
+ */
+void spi_wait(void)
+{
+    while (busy)
+        ;
+}
@@ -0,0 +1,16 @@
+/**
+ * Header file for spi.c
+ * Interrupt driven transfer queue for the OLED on SPI2
+ */
+
+#define SPI2_RX_IRQ (1 << 7) // SPI2 receive done flag in IFS(1)/IEC(1)
+
+#define SPI_COMMAND 0 // segment is sent with D/C low
+#define SPI_DATA 1    // segment is sent with D/C high
+
+void spi_init(void);
+void spi_service(void);
+void spi_queue(const uint8_t *data, uint16_t len, uint8_t dc);
+uint32_t spi_ticket(void);
+uint8_t spi_done(uint32_t ticket);
+void spi_wait(void);
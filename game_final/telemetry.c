@@ -0,0 +1,198 @@
+/**
+ * Telemetry on UART1. The game writes records into a ring and the
+ * UART1 transmit interrupt takes them out, so a record costs the game
+ * a copy of a few bytes and never a wait. The game is the only writer
+ * and the interrupt the only reader, each owns one index of the ring,
+ * so neither has to lock the other out. When the ring is full records
+ * are dropped and counted, and the count goes out ahead of the next
+ * record that fits. Only built with -DTELEMETRY.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdint.h>    // Enable use of uintX_t
+#include <pic32mx.h>   // Enable use of chipkit specific macros
+#include "clock.h"     // Enable access to animation frames and the core timer rate
+#include "isr.h"       // Enable access to the core timer and waiting for interrupts
+#include "gamedata.h"  // Enable access to the well size
+#include "telemetry.h" // Link with telemetry header file
+
+#ifdef TELEMETRY
+static uint8_t ring[TELEMETRY_RING];
+static volatile uint8_t head; // next free byte, only moved by the game
+static volatile uint8_t tail; // next byte to send, only moved by the interrupt
+static uint16_t dropped;      // records lost since the last one that fit
+static uint32_t pass_start;   // core timer at telemetry_pass_begin
+
+/**
+ * Starts UART1 at TELEMETRY_BAUD, 8 data bits, no parity, 1 stop bit
+ */
+void telemetry_init(void)
+{
+    U1MODE = 0x0008;                               // high speed baud rate generator
+    U1BRG = 80000000 / 4 / TELEMETRY_BAUD - 1;     // 80 MHz peripheral bus
+    U1STA = 0x0400;                                // transmitter on, interrupt while the FIFO has room
+    IPCCLR(6) = 0x1F;                              // UART1 priority 1, below the timers and input
+    IPCSET(6) = 1 << 2;
+    IFSCLR(0) = U1TX_IRQ;
+    IECCLR(0) = U1TX_IRQ;                          // enabled while there is something to send
+    U1MODESET = 0x8000;                            // UART1 on
+}
+
+/**
+ * UART1 transmit interrupt, fills the FIFO from the ring
+ */
+void telemetry_service(void)
+{
+    uint8_t t = tail;
+
+    while (t != head && !(U1STA & 0x0200)) // until the ring is empty or the FIFO full
+        U1TXREG = ring[t++];
+    tail = t;
+    if (t == head)
+        IECCLR(0) = U1TX_IRQ; // nothing left, record enables it again
+    IFSCLR(0) = U1TX_IRQ;
+}
+
+/**
+ * Writes one record from h on if there is room for it, the caller publishes it
+ * @return the head after the record, or h if it did not fit
+ */
+static uint8_t put(uint8_t h, uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint16_t stamp = clock_frames;
+    uint8_t sum, i;
+
+    if ((uint8_t)(h - tail) > TELEMETRY_RING - 1 - 4 - len)
+        return h;
+
+    ring[h++] = sum = TELEMETRY_MARK | type;
+    ring[h++] = stamp;
+    sum += stamp;
+    ring[h++] = stamp >> 8;
+    sum += stamp >> 8;
+    for (i = 0; i < len; i++)
+    {
+        ring[h++] = payload[i];
+        sum += payload[i];
+    }
+    ring[h++] = sum;
+    return h;
+}
+
+/**
+ * Queues a record and makes sure the interrupt is sending
+ */
+static void record(uint8_t type, const uint8_t *payload, uint8_t len)
+{
+    uint8_t h = head, next, n[2];
+
+    if (dropped)
+    { // tell the reader first
+        n[0] = dropped;
+        n[1] = dropped >> 8;
+        next = put(h, TELEMETRY_DROPPED, n, 2);
+        if (next == h)
+        {
+            dropped += dropped < 0xFFFF;
+            return;
+        }
+        h = next;
+        dropped = 0;
+    }
+
+    next = put(h, type, payload, len);
+    if (next == h)
+        dropped++;
+    if (next != head)
+    {
+        head = next; // the interrupt only sees a record once it is complete
+        IECSET(0) = U1TX_IRQ;
+    }
+}
+
+void telemetry_spawn(uint8_t figure, uint8_t next)
+{
+    uint8_t p[2] = {figure, next};
+    record(TELEMETRY_SPAWN, p, 2);
+}
+
+void telemetry_lock(uint8_t figure, uint8_t x, uint8_t y, uint8_t rotation)
+{
+    uint8_t p[4] = {figure, x, y, rotation};
+    record(TELEMETRY_LOCK, p, 4);
+}
+
+/**
+ * Full rows are always within the 4 rows of the figure that was locked,
+ * so a row and 4 bits cover any well height
+ */
+void telemetry_clear(well_rows rows)
+{
+    uint8_t p[2] = {0, 0};
+
+    while (!((rows >> p[0]) & 1))
+        p[0]++;
+    p[1] = rows >> p[0];
+    record(TELEMETRY_CLEAR, p, 2);
+}
+
+void telemetry_score(uint32_t score)
+{
+    uint8_t p[4] = {score, score >> 8, score >> 16, score >> 24};
+    record(TELEMETRY_SCORE, p, 4);
+}
+
+/**
+ * Marks the start of a game pass for telemetry_pass_end
+ */
+void telemetry_pass_begin(void)
+{
+    pass_start = read_core_timer();
+}
+
+/**
+ * Records how long the pass since telemetry_pass_begin took
+ */
+void telemetry_pass_end(void)
+{
+    uint32_t us = (read_core_timer() - pass_start) / CORE_TICKS_PER_US;
+    uint8_t p[2];
+
+    if (us > 0xFFFF)
+        us = 0xFFFF;
+    p[0] = us;
+    p[1] = us >> 8;
+    record(TELEMETRY_FRAME, p, 2);
+}
+
+void telemetry_overrun(uint8_t ticks)
+{
+    record(TELEMETRY_OVERRUN, &ticks, 1);
+}
+
+/**
+ * Sends a line of text, TELEMETRY_TEXT_CHARS characters a record. Waits
+ * for room in the ring instead of dropping, so only for reports sent
+ * while the game has nothing else to do, like at game over.
+ */
+void telemetry_text(const char *text)
+{
+    uint8_t p[TELEMETRY_TEXT_CHARS], i, end = 0;
+
+    while (!end)
+    {
+        for (i = 0; i < TELEMETRY_TEXT_CHARS; i++)
+        {
+            if (*text)
+                p[i] = *text++;
+            else
+            {
+                p[i] = end ? 0 : '\n';
+                end = 1;
+            }
+        }
+        while ((uint8_t)(head - tail) > TELEMETRY_RING / 2) // room for this and a dropped count
+            wait_for_interrupt();
+        record(TELEMETRY_TEXT, p, TELEMETRY_TEXT_CHARS);
+    }
+}
+#endif
@@ -0,0 +1,53 @@
+/**
+ * Header file for telemetry.c
+ * Binary game event records sent on UART1, built with -DTELEMETRY.
+ * tools/teledec turns the stream into CSV.
+ *
+ * Every record is
+ *   0xA0 | type, stamp (2 bytes), payload, checksum
+ * with multi byte values least significant byte first. The stamp is the
+ * low 16 bits of clock_frames, TELEMETRY_US_PER_STAMP apart, and the
+ * checksum is the sum of the bytes before it.
+ */
+
+#define U1TX_IRQ (1 << 28) // UART1 transmit flag in IFS(0)/IEC(0)
+
+#define TELEMETRY_BAUD 115200
+#define TELEMETRY_RING 256 // bytes waiting to be sent, indexes wrap with uint8_t
+#define TELEMETRY_US_PER_STAMP 4000
+
+#define TELEMETRY_MARK 0xA0    // high nibble of the first byte of every record
+#define TELEMETRY_SPAWN 1      // figure, next figure
+#define TELEMETRY_LOCK 2       // figure, column, row, rotation
+#define TELEMETRY_CLEAR 3      // lowest full row, then bit i for row lowest + i
+#define TELEMETRY_SCORE 4      // score, 4 bytes
+#define TELEMETRY_FRAME 5      // microseconds a game pass took, 2 bytes
+#define TELEMETRY_OVERRUN 6    // game ticks a pass was late by, 1 byte
+#define TELEMETRY_DROPPED 7    // records lost to a full ring before this one, 2 bytes
+#define TELEMETRY_TEXT 8       // TELEMETRY_TEXT_CHARS characters of a report line, '\n' ends it, 0 pads
+#define TELEMETRY_TYPES 9
+
+#define TELEMETRY_TEXT_CHARS 8
+#define TELEMETRY_PAYLOAD {0, 2, 4, 2, 4, 2, 1, 2, TELEMETRY_TEXT_CHARS} // payload bytes of each type
+
+#ifdef TELEMETRY
+void telemetry_init(void);
+void telemetry_service(void);
+void telemetry_spawn(uint8_t figure, uint8_t next);
+void telemetry_lock(uint8_t figure, uint8_t x, uint8_t y, uint8_t rotation);
+void telemetry_clear(well_rows rows);
+void telemetry_score(uint32_t score);
+void telemetry_pass_begin(void);
+void telemetry_pass_end(void);
+void telemetry_overrun(uint8_t ticks);
+void telemetry_text(const char *text);
+#else
+#define telemetry_init() ((void)0)
+#define telemetry_spawn(figure, next) ((void)0)
+#define telemetry_lock(figure, x, y, rotation) ((void)0)
+#define telemetry_clear(rows) ((void)0)
+#define telemetry_score(score) ((void)0)
+#define telemetry_pass_begin() ((void)0)
+#define telemetry_pass_end() ((void)0)
+#define telemetry_overrun(ticks) ((void)0)
+#endif
@@ -0,0 +1,20 @@
+/**
+ * The check every host test uses, include stdio.h first.
+ * A failed check prints the test function and the message and is
+ * counted in failures, the test goes on and main reports the count.
+ * For copyright and licensing, see file COPYING
+ */
+
+#define CHECK(cond, ...)                  \
+    do                                    \
+    {                                     \
+        if (!(cond))                      \
+        {                                 \
+            printf("FAIL %s: ", __func__); \
+            printf(__VA_ARGS__);          \
+            printf("\n");                 \
+            failures++;                   \
+        }                                 \
+    } while (0)
+
+static int failures;
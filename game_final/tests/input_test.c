@@ -0,0 +1,194 @@
+/**
+ * Host test of the button debounce, see the test target of the Makefile.
+ * Contacts that bounce when they close or open have to make one press
+ * and one release, a tap shorter than the lockout still has to make both
+ * and separate presses of different buttons must not lock each other out.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdio.h>   // Enable use of printf
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable access to the register stand-in
+#include "host.h"    // Enable access to the test hooks
+#include "clock.h"   // Enable access to the clocks
+#include "input.h"   // Enable access to the input events
+#include "isr.h"     // Enable access to waiting for interrupts
+#include "check.h"   // Enable use of CHECK
+
+/* What one scenario made of one button */
+struct tally
+{
+    uint8_t presses, releases;
+    uint32_t press_frame, release_frame; // of the first press and the last release
+};
+
+static struct tally tally[6];
+static double start_ms;     // start of the running scenario
+static uint32_t start_frame; // clock_frames at its start
+
+/* The interrupts the buttons need, as isr.c dispatches them */
+void user_isr(void)
+{
+    if (IFS(0) & T2_IRQ)
+        clock_service_tick();
+    if (IFS(0) & T3_IRQ)
+    {
+        clock_service_frame();
+        input_sample();
+    }
+    if (IFS(1) & CN_IRQ)
+        input_service_change();
+    if (IFS(0) & INT4_IRQ)
+        input_service_int4();
+}
+
+static double now_ms(void)
+{
+    return clock_us() / 1000.0;
+}
+
+/**
+ * Starts a scenario a little after now, pin changes are at ms from its start
+ */
+static void begin(void)
+{
+    uint8_t b;
+
+    for (b = 0; b < 6; b++)
+        tally[b].presses = tally[b].releases = 0;
+    start_ms = now_ms() + 10;
+    start_frame = clock_frames + 10 * CLOCK_FRAME_HZ / 1000;
+}
+
+static void pin(double ms, uint8_t which, uint8_t level)
+{
+    if (!host_pin(start_ms + ms, which, level))
+        CHECK(0, "cannot set pin %u at %.1f ms", which, ms);
+}
+
+/**
+ * Runs until ms after the start of the scenario and counts the events
+ */
+static void run(double ms)
+{
+    struct input_event ev;
+    uint8_t b;
+
+    while (now_ms() < start_ms + ms)
+    {
+        wait_for_interrupt();
+        while (input_event(&ev))
+        {
+            for (b = 0; !((ev.button >> b) & 1); b++)
+                ;
+            if (ev.kind == INPUT_PRESS && !tally[b].presses++)
+                tally[b].press_frame = ev.frame;
+            if (ev.kind == INPUT_RELEASE)
+            {
+                tally[b].releases++;
+                tally[b].release_frame = ev.frame;
+            }
+        }
+    }
+}
+
+static void check_presses(const char *what, uint8_t b, uint8_t presses)
+{
+    CHECK(tally[b].presses == presses && tally[b].releases == presses, "%s: %u presses and %u releases, not %u",
+          what, tally[b].presses, tally[b].releases, presses);
+}
+
+/**
+ * A press and a release with nothing bouncing
+ */
+static void test_clean(void)
+{
+    begin();
+    pin(0, HOST_BTN2, 1);
+    pin(50, HOST_BTN2, 0);
+    run(80);
+    check_presses("button 2", 1, 1);
+}
+
+/**
+ * Bounces when closing and when opening, on a change notice button, on
+ * the sampled button 1 and on switch 4 with its edge interrupt
+ */
+static void test_bounces(void)
+{
+    static const double close[] = {0, 0.2, 0.5, 0.9, 1.4, 2.5, 3.1};
+    static const uint8_t pins[3] = {HOST_BTN3, HOST_BTN1, HOST_SW4};
+    static const uint8_t bits[3] = {2, 0, 4};
+    static const char *names[3] = {"button 3", "button 1", "switch 4"};
+    uint8_t p, i;
+
+    for (p = 0; p < 3; p++)
+    {
+        begin();
+        for (i = 0; i < 7; i++)
+            pin(close[i], pins[p], !(i & 1));
+        for (i = 0; i < 7; i++)
+            pin(100 + close[i], pins[p], i & 1);
+        run(150);
+        check_presses(names[p], bits[p], 1);
+        CHECK(tally[bits[p]].press_frame - start_frame <= 2, "%s: pressed %u frames after the first contact", names[p],
+              tally[bits[p]].press_frame - start_frame);
+    }
+}
+
+/**
+ * A tap that is over before the lockout, its release is taken from the
+ * frame sample once the lockout ends
+ */
+static void test_short_tap(void)
+{
+    begin();
+    pin(0, HOST_BTN4, 1);
+    pin(3, HOST_BTN4, 0);
+    run(40);
+    check_presses("button 4", 3, 1);
+    CHECK(tally[3].release_frame - tally[3].press_frame <= (INPUT_DEBOUNCE_US / 1000 + 4) * CLOCK_FRAME_HZ / 1000,
+          "released %u frames after the press", tally[3].release_frame - tally[3].press_frame);
+}
+
+/**
+ * Presses further apart than the lockout are all kept, and one button
+ * does not lock out another
+ */
+static void test_separate_presses(void)
+{
+    begin();
+    pin(0, HOST_BTN3, 1);
+    pin(8, HOST_BTN3, 0);
+    pin(16, HOST_BTN3, 1);
+    pin(24, HOST_BTN3, 0);
+    run(60);
+    check_presses("button 3 twice", 2, 2);
+
+    begin();
+    pin(0, HOST_BTN2, 1);
+    pin(0.5, HOST_BTN3, 1);
+    pin(1, HOST_BTN1, 1);
+    pin(30, HOST_BTN2, 0);
+    pin(30, HOST_BTN3, 0);
+    pin(30, HOST_BTN1, 0);
+    run(60);
+    check_presses("button 2 with 3 and 1", 1, 1);
+    check_presses("button 3 with 2 and 1", 2, 1);
+    check_presses("button 1 with 2 and 3", 0, 1);
+}
+
+int main(void)
+{
+    host_start(3600);
+    clock_init();
+    input_init();
+    enable_interrupt();
+
+    test_clean();
+    test_bounces();
+    test_short_tap();
+    test_separate_presses();
+
+    printf("input_test: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
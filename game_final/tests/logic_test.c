@@ -0,0 +1,381 @@
+/**
+ * Host test of the figures and their rotation, see the test target of the
+ * Makefile. Checks the shape table against the figures it describes, the
+ * kick table against the guideline (SRS) kicks it is derived from, and
+ * rotate_figure against every piece, rotation and position in the well,
+ * with the walls, the floor and blocks on the field in the way.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdio.h>    // Enable use of printf
+#include <string.h>   // Enable use of memset
+#include <stdint.h>   // Enable use of uintX_t
+#include "gamedata.h" // Enable access to the shape and kick tables
+#include "logic.h"    // Enable access to the game logic
+#include "check.h"    // Enable use of CHECK
+
+static const char names[] = "IJLOSTZ";
+
+/**
+ * Every figure in its guideline spawn orientation, in the guideline
+ * rotation box, cells as in struct shape: row i in bits i * 4 to i * 4 + 3
+ */
+static const struct
+{
+    uint16_t cells;
+    uint8_t box;   // side of the rotation box
+    uint8_t spawn; // guideline orientation of rotation 0 of shapes
+} guideline[7] = {
+    {0x00F0, 4, 0}, // I
+    {0x0071, 3, 0}, // J
+    {0x0074, 3, 0}, // L
+    {0x0066, 4, 0}, // O
+    {0x0036, 3, 0}, // S
+    {0x0072, 3, 2}, // T, spawns pointing down
+    {0x0063, 3, 0}, // Z
+};
+
+/**
+ * Guideline kicks for a clockwise rotation out of each orientation, rows
+ * counted upwards as the guideline does
+ */
+static const struct kick srs_jlstz[4][KICK_TESTS] = {
+    {{0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2}},
+    {{0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2}},
+    {{0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2}},
+    {{0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2}},
+};
+static const struct kick srs_i[4][KICK_TESTS] = {
+    {{0, 0}, {-2, 0}, {1, 0}, {-2, -1}, {1, 2}},
+    {{0, 0}, {-1, 0}, {2, 0}, {-1, 2}, {2, -1}},
+    {{0, 0}, {2, 0}, {-1, 0}, {2, 1}, {-1, -2}},
+    {{0, 0}, {1, 0}, {-2, 0}, {1, -2}, {-2, 1}},
+};
+
+static uint8_t cell(uint16_t cells, uint8_t x, uint8_t y)
+{
+    return (cells >> (y * 4 + x)) & 1;
+}
+
+/**
+ * Turns the cells of a rotation box clockwise
+ */
+static uint16_t turn(uint16_t cells, uint8_t box)
+{
+    uint16_t out = 0;
+    uint8_t x, y;
+
+    for (y = 0; y < box; y++)
+        for (x = 0; x < box; x++)
+            if (cell(cells, x, y))
+                out |= 1 << (x * 4 + box - 1 - y);
+    return out;
+}
+
+/**
+ * Moves cells to the top left corner, tells how far they were moved
+ */
+static uint16_t trim(uint16_t cells, uint8_t *dx, uint8_t *dy)
+{
+    *dx = *dy = 0;
+    while (!(cells & 0x000F))
+    {
+        cells >>= 4;
+        ++*dy;
+    }
+    while (!(cells & 0x1111))
+    {
+        cells >>= 1;
+        ++*dx;
+    }
+    return cells;
+}
+
+/**
+ * Every rotation fills exactly its box, with 4 cells, and the bottom
+ * cells are the lowest cell of each column
+ */
+static void test_shapes(void)
+{
+    const struct shape *s;
+    uint8_t f, r, x, y, n, low;
+
+    for (f = 0; f < 7; f++)
+        for (r = 0; r < 4; r++)
+        {
+            s = &shapes[f][r];
+            for (n = 0, y = 0; y < 4; y++)
+                for (x = 0; x < 4; x++)
+                    if (cell(s->mask, x, y))
+                    {
+                        n++;
+                        CHECK(x < s->w && y < s->h, "%c%u: cell %u,%u outside its %ux%u box", names[f], r, x, y, s->w, s->h);
+                    }
+            CHECK(n == 4, "%c%u: %u cells", names[f], r, n);
+            for (y = 0; y < s->h; y++)
+                CHECK(SHAPE_ROW(s->mask, y), "%c%u: row %u empty", names[f], r, y);
+            for (x = 0; x < s->w; x++)
+            {
+                for (low = 0, y = 0; y < s->h; y++)
+                    if (cell(s->mask, x, y))
+                        low = y;
+                CHECK(cell(s->mask, x, 0) || low, "%c%u: column %u empty", names[f], r, x);
+                CHECK(SHAPE_BOTTOM(s->bottom, x) == low, "%c%u: column %u bottom %u, lowest cell %u", names[f], r, x,
+                      SHAPE_BOTTOM(s->bottom, x), low);
+            }
+        }
+}
+
+/**
+ * Each rotation is the one before turned clockwise, and each kick is the
+ * guideline kick plus the move of the shape box in the rotation box
+ */
+static void test_kicks(void)
+{
+    uint16_t cells[4];
+    uint8_t dx[4], dy[4];
+    const struct kick *srs;
+    struct kick want;
+    uint8_t f, r, o, t;
+
+    for (f = 0; f < 7; f++)
+    {
+        cells[0] = guideline[f].cells;
+        for (o = 1; o < 4; o++)
+            cells[o] = turn(cells[o - 1], guideline[f].box);
+        for (r = 0; r < 4; r++)
+        {
+            o = (guideline[f].spawn + r) & 3;
+            CHECK(trim(cells[o], &dx[r], &dy[r]) == shapes[f][r].mask, "%c%u is not the guideline figure turned %u times",
+                  names[f], r, o);
+        }
+        for (r = 0; r < 4; r++)
+        {
+            o = (guideline[f].spawn + r) & 3;
+            srs = f == 0 ? srs_i[o] : srs_jlstz[o];
+            for (t = 0; t < KICK_TESTS; t++)
+            {
+                if (f == 3) // the O does not move when it turns
+                    want.x = want.y = 0;
+                else
+                {
+                    want.x = dx[(r + 1) & 3] - dx[r] + srs[t].x;
+                    want.y = dy[(r + 1) & 3] - dy[r] - srs[t].y;
+                }
+                CHECK(kicks[f][r][t].x == want.x && kicks[f][r][t].y == want.y, "%c%u kick %u is %d,%d, guideline %d,%d",
+                      names[f], r, t, kicks[f][r][t].x, kicks[f][r][t].y, want.x, want.y);
+            }
+        }
+    }
+}
+
+/**
+ * Whether a shape with its box at column x and row y is in the well and
+ * clear of the field, worked out cell by cell
+ */
+static uint8_t fits(const well_row *field, uint16_t mask, int x, int y)
+{
+    uint8_t i, j;
+
+    for (i = 0; i < 4; i++)
+        for (j = 0; j < 4; j++)
+            if (cell(mask, j, i))
+            {
+                if (x + j < 0 || x + j >= WELL_WIDTH || y + i < 0 || y + i >= WELL_HEIGHT)
+                    return 0;
+                if ((field[y + i] >> (x + j)) & 1)
+                    return 0;
+            }
+    return 1;
+}
+
+/**
+ * A game with an empty field and the figure taken off it, as game.c has
+ * it when the rotate button is handled
+ */
+static void start(struct game_state *g, uint8_t figure, uint8_t rotation, int x, int y)
+{
+    static uint32_t highscores[5][5];
+
+    memset(g, 0, sizeof(*g));
+    game_reset(g, highscores, 1, RANDOM_BAG);
+    remove_figure_from_screen_field(g);
+    g->figure_type = figure;
+    g->rotation = rotation;
+    g->pos_x = shapes[figure][rotation].w;
+    g->pos_y = shapes[figure][rotation].h;
+    g->move_x = x - g->offset;
+    g->move_y = y;
+}
+
+/**
+ * Rotates and checks the figure ends up where the first kick that fits
+ * puts it, or stays as it was if none fits
+ */
+static void check_rotation(struct game_state *g, const char *what)
+{
+    const struct kick *k = kicks[g->figure_type][g->rotation];
+    const struct shape *s = &shapes[g->figure_type][(g->rotation + 1) & 3];
+    int x = g->offset + g->move_x, y = g->move_y;
+    uint8_t rotation = g->rotation, t, done;
+
+    for (t = 0; t < KICK_TESTS && !fits(g->field, s->mask, x + k[t].x, y + k[t].y); t++)
+        ;
+    done = rotate_figure(g);
+    if (t == KICK_TESTS)
+    {
+        CHECK(!done, "%s %c%u at %d,%d: rotated with no kick that fits", what, names[g->figure_type], rotation, x, y);
+        CHECK(g->rotation == rotation && g->offset + g->move_x == x && g->move_y == y, "%s %c%u at %d,%d: moved",
+              what, names[g->figure_type], rotation, x, y);
+        return;
+    }
+    CHECK(done, "%s %c%u at %d,%d: not rotated, kick %u fits", what, names[g->figure_type], rotation, x, y, t);
+    CHECK(g->rotation == ((rotation + 1) & 3), "%s %c%u at %d,%d: rotation %u", what, names[g->figure_type], rotation,
+          x, y, g->rotation);
+    CHECK(g->offset + g->move_x == x + k[t].x && g->move_y == y + k[t].y, "%s %c%u at %d,%d: at %d,%d, kick %u is %d,%d",
+          what, names[g->figure_type], rotation, x, y, g->offset + g->move_x, g->move_y, t, x + k[t].x, y + k[t].y);
+    CHECK(g->pos_x == s->w && g->pos_y == s->h, "%s %c%u at %d,%d: box %ux%u", what, names[g->figure_type], rotation, x,
+          y, g->pos_x, g->pos_y);
+}
+
+/**
+ * Every piece in every rotation at every place it can be in an empty
+ * well, which takes in every wall and floor kick
+ */
+static void test_empty_well(void)
+{
+    struct game_state g;
+    uint8_t f, r;
+    int x, y;
+
+    for (f = 0; f < 7; f++)
+        for (r = 0; r < 4; r++)
+            for (y = 0; y + shapes[f][r].h <= WELL_HEIGHT; y++)
+                for (x = 0; x + shapes[f][r].w <= WELL_WIDTH; x++)
+                {
+                    start(&g, f, r, x, y);
+                    check_rotation(&g, "empty");
+                }
+}
+
+/**
+ * Turning 4 times in the open comes back to the same place
+ */
+static void test_full_turn(void)
+{
+    struct game_state g;
+    uint8_t f, r, n;
+    int x = WELL_WIDTH / 2 - 2, y = WELL_HEIGHT / 2 - 2;
+
+    if (WELL_WIDTH < 8 || WELL_HEIGHT < 8)
+        return; // every kick has to fit around the figure
+    for (f = 0; f < 7; f++)
+        for (r = 0; r < 4; r++)
+        {
+            start(&g, f, r, x, y);
+            for (n = 0; n < 4; n++)
+                rotate_figure(&g);
+            CHECK(g.rotation == r && g.offset + g.move_x == x && g.move_y == y, "%c%u: at %d,%d rotation %u after 4 turns",
+                  names[f], r, g.offset + g.move_x, g.move_y, g.rotation);
+        }
+}
+
+/**
+ * An I standing against either wall or lying on the floor is kicked
+ * back into the well
+ */
+static void test_walls_and_floor(void)
+{
+    struct game_state g;
+
+    start(&g, 0, 1, 0, WELL_HEIGHT / 2 - 2);
+    CHECK(rotate_figure(&g) && g.offset + g.move_x == 0 && g.rotation == 2, "left wall: at %d rotation %u",
+          g.offset + g.move_x, g.rotation);
+    start(&g, 0, 3, WELL_WIDTH - 1, WELL_HEIGHT / 2 - 2);
+    CHECK(rotate_figure(&g) && g.offset + g.move_x == WELL_WIDTH - 4 && g.rotation == 0,
+          "right wall: at %d rotation %u", g.offset + g.move_x, g.rotation);
+    start(&g, 0, 0, 0, WELL_HEIGHT - 1);
+    CHECK(rotate_figure(&g) && g.move_y == WELL_HEIGHT - 4 && g.rotation == 1, "floor: at row %u rotation %u", g.move_y,
+          g.rotation);
+    start(&g, 1, 1, WELL_WIDTH - 2, WELL_HEIGHT - 3);
+    CHECK(rotate_figure(&g) && g.offset + g.move_x == WELL_WIDTH - 3 && g.move_y == WELL_HEIGHT - 2,
+          "J in the corner: at %d,%u", g.offset + g.move_x, g.move_y);
+}
+
+/**
+ * Every piece, rotation and place on fields with blocks in the way
+ */
+static void test_stacks(void)
+{
+    struct game_state g;
+    well_row field[WELL_HEIGHT];
+    uint32_t seed = 2463534242u;
+    uint8_t f, r, i, n;
+    int x, y;
+
+    for (n = 0; n < 40; n++)
+    {
+        for (i = 0; i < WELL_HEIGHT; i++)
+        { // xorshift32, denser towards the floor and never a full row
+            seed ^= seed << 13;
+            seed ^= seed >> 17;
+            seed ^= seed << 5;
+            field[i] = i < WELL_HEIGHT / 3 ? 0 : seed & (seed >> 8) & WELL_FULL;
+            if (i >= WELL_HEIGHT / 2)
+                field[i] |= seed >> 16;
+            field[i] &= WELL_FULL & ~(1 << (seed >> 28) % WELL_WIDTH);
+        }
+        for (f = 0; f < 7; f++)
+            for (r = 0; r < 4; r++)
+                for (y = 0; y + shapes[f][r].h <= WELL_HEIGHT; y++)
+                    for (x = 0; x + shapes[f][r].w <= WELL_WIDTH; x++)
+                        if (fits(field, shapes[f][r].mask, x, y))
+                        {
+                            start(&g, f, r, x, y);
+                            memcpy(g.field, field, sizeof(field));
+                            check_rotation(&g, "stack");
+                            CHECK(!memcmp(g.field, field, sizeof(field)), "stack %c%u at %d,%d: field changed", names[f],
+                                  r, x, y);
+                        }
+    }
+}
+
+/**
+ * A T standing in the neck of a T shaped slot turns into the slot, and
+ * an I walled in on both sides does not turn at all
+ */
+static void test_slots(void)
+{
+    struct game_state g;
+    int x = WELL_WIDTH / 2 - 1;
+    uint8_t i;
+
+    // the neck is column x + 1 of the row above the floor and the one above
+    // that, the slot is columns x to x + 2 of the row in between
+    start(&g, 5, 3, x + 1, WELL_HEIGHT - 3);
+    g.field[WELL_HEIGHT - 3] = WELL_FULL & ~(1 << (x + 1));
+    g.field[WELL_HEIGHT - 2] = WELL_FULL & ~(7 << x);
+    g.field[WELL_HEIGHT - 1] = WELL_FULL & ~(1 << (x + 1));
+    check_rotation(&g, "slot");
+    CHECK(g.rotation == 0 && g.offset + g.move_x == x && g.move_y == WELL_HEIGHT - 2, "slot: at %d,%u rotation %u",
+          g.offset + g.move_x, g.move_y, g.rotation);
+
+    start(&g, 0, 1, x, WELL_HEIGHT - 4);
+    for (i = 0; i < WELL_HEIGHT; i++)
+        g.field[i] = WELL_FULL & ~(1 << x);
+    check_rotation(&g, "walled in");
+    CHECK(g.rotation == 1, "walled in: rotated to %u", g.rotation);
+}
+
+int main(void)
+{
+    test_shapes();
+    test_kicks();
+    test_empty_well();
+    test_full_turn();
+    test_walls_and_floor();
+    test_stacks();
+    test_slots();
+
+    printf("logic_test: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
@@ -0,0 +1,256 @@
+/**
+ * Host test of the SPI transfer queue, see the test target of the Makefile.
+ * Whatever is queued has to leave SPI2 byte for byte and with the same
+ * D/C levels as when it is sent one byte at a time with spi_send_recv,
+ * also when the interrupt empties the queue while a segment is queued.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdio.h>   // Enable use of printf
+#include <string.h>  // Enable use of memcpy
+#include <stdint.h>  // Enable use of uintX_t
+#include <pic32mx.h> // Enable access to the register stand-in
+#include "host.h"    // Enable access to the test hooks
+#include "display.h" // Enable access to the framebuffer
+#include "isr.h"     // Enable access to waiting for interrupts
+#include "check.h"   // Enable use of CHECK
+
+/*
+ * spi.c is built into this file with its own spi_queue renamed, so the
+ * segments display.c queues can be recorded, and with every access to
+ * queue_head going through queue_head_access, which can empty the queue
+ * right after queue_head moved, as if the interrupt came at that moment.
+ */
+static volatile uint16_t *queue_head_access(void);
+#define spi_queue spi_queue_engine
+#define queue_head (*queue_head_access())
+#include "spi.c"
+#undef queue_head
+#undef spi_queue
+
+#define TRACE_MAX 8192
+#define SEGMENTS_MAX 256
+
+/* A byte on the wire and the D/C level it went out with */
+struct wire
+{
+    uint8_t byte, dc;
+};
+
+static struct wire trace[TRACE_MAX];
+static uint16_t traced;
+
+static uint8_t log_data[TRACE_MAX]; // segments handed to spi_queue, back to back
+static uint16_t log_len[SEGMENTS_MAX];
+static uint8_t log_dc[SEGMENTS_MAX];
+static uint16_t logged, logged_bytes;
+
+static uint16_t head_value, head_seen;
+static uint8_t interrupt_on_head; // empty the queue whenever queue_head moved
+
+static void trace_byte(uint8_t byte, uint8_t dc)
+{
+    if (traced < TRACE_MAX)
+    {
+        trace[traced].byte = byte;
+        trace[traced].dc = dc;
+    }
+    traced++;
+}
+
+/**
+ * Lets the interrupt send everything queued, a queue that never runs dry
+ * has lost track of where its data ends
+ */
+static void drain(void)
+{
+    uint32_t waits = 0;
+
+    while (busy)
+    {
+        if (++waits > 4 * SPI_QUEUE_BYTES)
+        {
+            CHECK(0, "the queue never runs dry, tail %u head %u", queue_tail, head_value);
+            IECCLR(1) = SPI2_RX_IRQ;
+            busy = 0;
+            return;
+        }
+        wait_for_interrupt();
+    }
+}
+
+static volatile uint16_t *queue_head_access(void)
+{
+    if (interrupt_on_head && head_value != head_seen && !host_in_isr())
+    {
+        head_seen = head_value;
+        drain();
+    }
+    head_seen = head_value;
+    return &head_value;
+}
+
+/**
+ * spi_queue as display.c sees it, every segment is recorded on its way in
+ */
+void spi_queue(const uint8_t *data, uint16_t len, uint8_t dc)
+{
+    if (logged < SEGMENTS_MAX && logged_bytes + len <= TRACE_MAX)
+    {
+        memcpy(log_data + logged_bytes, data, len);
+        log_len[logged] = len;
+        log_dc[logged] = dc;
+        logged++;
+        logged_bytes += len;
+    }
+    spi_queue_engine(data, len, dc);
+}
+
+void user_isr(void)
+{
+    if (IFS(1) & SPI2_RX_IRQ)
+        spi_service();
+}
+
+/**
+ * Sends the recorded segments the blocking way and checks the wire saw the same
+ */
+static void check_against_blocking(const char *what)
+{
+    static struct wire queued_trace[TRACE_MAX];
+    uint16_t n = traced, s, i, at = 0;
+
+    CHECK(n <= TRACE_MAX, "%s: trace overflow", what);
+    memcpy(queued_trace, trace, sizeof(trace));
+    traced = 0;
+    for (s = 0; s < logged; s++)
+    {
+        if (log_dc[s])
+            PORTFSET = 0x10;
+        else
+            PORTFCLR = 0x10;
+        for (i = 0; i < log_len[s]; i++)
+            spi_send_recv(log_data[at++]);
+    }
+
+    CHECK(traced == n, "%s: %u bytes queued, %u sent blocking", what, n, traced);
+    for (i = 0; i < n && i < traced; i++)
+        if (trace[i].byte != queued_trace[i].byte || trace[i].dc != queued_trace[i].dc)
+        {
+            CHECK(0, "%s: byte %u is %02x/%u queued, %02x/%u blocking", what, i,
+                  queued_trace[i].byte, queued_trace[i].dc, trace[i].byte, trace[i].dc);
+            break;
+        }
+    traced = logged = logged_bytes = 0;
+}
+
+/**
+ * The panel model shows what the framebuffer holds
+ */
+static void check_panel(const char *what)
+{
+    uint8_t p, c;
+
+    for (p = 0; p < DISPLAY_PAGES; p++)
+        for (c = 0; c < DISPLAY_COLUMNS; c++)
+            if (host_panel(p, c) != display_buffer[p][c])
+            {
+                CHECK(0, "%s: page %u column %u is %02x, framebuffer %02x", what, p, c,
+                      host_panel(p, c), display_buffer[p][c]);
+                return;
+            }
+}
+
+/**
+ * Segments of every length class, split at the header limit or not
+ */
+static void test_segments(void)
+{
+    static const uint8_t window[6] = {0x21, 0, 127, 0x22, 0, 3};
+    static const uint8_t contrast[2] = {0x81, 0x7F};
+    static uint8_t data[600];
+    uint16_t i;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = i * 7 + 3;
+    spi_queue(window, 6, SPI_COMMAND);
+    spi_queue(data, 512, SPI_DATA);
+    spi_queue(contrast, 2, SPI_COMMAND);
+    spi_queue(data, 1, SPI_DATA);
+    spi_queue(data + 5, 128, SPI_DATA);
+    spi_queue(data + 9, 129, SPI_DATA);
+    spi_queue(data, 600, SPI_DATA); // more than is free while the frame above is going out
+    drain();
+    CHECK(traced == 6 + 512 + 2 + 1 + 128 + 129 + 600, "%u bytes sent", traced);
+    check_against_blocking("segments");
+}
+
+/**
+ * A whole frame and then a few scattered changes, through display_present
+ */
+static void test_frame(void)
+{
+    uint16_t p, c;
+    uint32_t x = 12345;
+
+    for (p = 0; p < DISPLAY_PAGES; p++)
+        for (c = 0; c < DISPLAY_COLUMNS; c++)
+            display_buffer[p][c] = (x = x * 1103515245 + 12345) >> 16;
+    display_invalidate();
+    display_present();
+    drain();
+    check_panel("full frame");
+    check_against_blocking("full frame");
+
+    for (c = 0; c < 40; c++)
+    {
+        display_set_cursor(c & 3, (c * 37) & 127);
+        display_write(c * 11);
+    }
+    display_present();
+    drain();
+    check_panel("changes");
+    check_against_blocking("changes");
+}
+
+/**
+ * The interrupt empties the queue every time queue_head moves, the moment
+ * a header would be visible before its data if queue_head moved too early
+ */
+static void test_interrupt_after_header(void)
+{
+    static const uint8_t window[6] = {0x21, 10, 20, 0x22, 1, 2};
+    static uint8_t data[40];
+    uint8_t i, round;
+
+    for (i = 0; i < sizeof(data); i++)
+        data[i] = 0xC0 + i;
+    interrupt_on_head = 1;
+    for (round = 0; round < 20; round++)
+    {
+        spi_queue(window, 6, SPI_COMMAND);
+        spi_queue(data, 3 + round, SPI_DATA);
+        spi_queue(window + 3, 3, SPI_COMMAND);
+        spi_queue(data + round, 1, SPI_DATA);
+    }
+    drain();
+    interrupt_on_head = 0;
+    CHECK(queue_tail == head_value, "tail %u head %u", queue_tail, head_value);
+    check_against_blocking("interrupt after header");
+}
+
+int main(void)
+{
+    host_start(3600);
+    SPI2BRG = 4; // as main sets it up
+    SPI2CONSET = 0x8060;
+    spi_init();
+    enable_interrupt();
+    host_spi_trace = trace_byte;
+
+    test_segments();
+    test_frame();
+    test_interrupt_after_header();
+
+    printf("spi_test: %s\n", failures ? "FAILED" : "ok");
+    return failures != 0;
+}
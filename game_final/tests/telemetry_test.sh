@@ -0,0 +1,128 @@
+#!/bin/sh
+#
+# Round trip of the telemetry records, see the test target of the Makefile.
+# Plays a scripted game on tests/telemetry-host, a -DTELEMETRY host build
+# with a well 4 columns wide so rows get cleared often, once with UART1
+# written to a file and once streamed through a pipe, decodes both with
+# tools/teledec and checks the CSV record by record. The build counts
+# display traffic and profiles too, so both reports have to come out at
+# game over.
+# For copyright and licensing, see file COPYING
+
+HOST=${HOST:-tests/telemetry-host}
+TELEDEC=${TELEDEC:-tools/teledec}
+WIDTH=4
+HEIGHT=24
+SECONDS_PLAYED=300
+
+dir=$(mktemp -d) || exit 1
+trap 'rm -rf "$dir"' EXIT
+
+fail()
+{
+    echo "FAIL telemetry: $*"
+    echo "telemetry_test: FAILED"
+    exit 1
+}
+
+# random presses of the four buttons, 30 ms each, starting at the title screen
+awk 'BEGIN {
+    s = 12345
+    for (t = 500; t < '$SECONDS_PLAYED'000; t += 60 + s % 200) {
+        s = (s * 1103515245 + 12345) % 2147483648
+        b = int(s / 65536) % 4 + 1
+        printf "%d btn%d 1\n%d btn%d 0\n", t, b, t + 30, b
+    }
+}' > "$dir/script" || fail "cannot write the script"
+
+"$HOST" -t $SECONDS_PLAYED -u "$dir/uart" "$dir/script" 2> "$dir/stats" || fail "$HOST did not run"
+"$TELEDEC" "$dir/uart" > "$dir/file.csv" 2> "$dir/text" || fail "$TELEDEC did not run"
+grep -q '^teledec:' "$dir/text" && fail "decoding the file: $(grep '^teledec:' "$dir/text")"
+grep -q '^phase  *source' "$dir/text" || fail "no display traffic report"
+grep -q '^phase  *passes' "$dir/text" || fail "no frame phase report"
+
+"$HOST" -t $SECONDS_PLAYED -u - "$dir/script" 2> /dev/null | "$TELEDEC" > "$dir/pipe.csv" 2> "$dir/errors"
+grep -q '^teledec:' "$dir/errors" && fail "decoding the pipe: $(grep '^teledec:' "$dir/errors")"
+cmp -s "$dir/file.csv" "$dir/pipe.csv" || fail "the file and the pipe decode differently"
+
+bytes=$(awk '/uart bytes/ { print $3 }' "$dir/stats")
+[ "$bytes" = "$(wc -c < "$dir/uart" | tr -d ' ')" ] || fail "$bytes bytes sent, $(wc -c < "$dir/uart") captured"
+
+awk -F, -v width=$WIDTH -v height=$HEIGHT '
+function bad(what) { printf "FAIL telemetry: line %d: %s: %s\n", NR, what, $0; failed = 1; exit }
+function number(f, lo, hi) { return $f ~ /^[0-9]+$/ && $f + 0 >= lo && $f + 0 <= hi }
+function empty(from, to,   f) { for (f = from; f <= to; f++) if ($f != "") return 0; return 1 }
+NR == 1 {
+    if ($0 != "time_ms,event,figure,next,x,y,rotation,lines,rows,score,us,ticks,dropped")
+        bad("header")
+    expect = "spawn"
+    next
+}
+{
+    if (NF != 13) bad("fields")
+    if (!number(1, last_ms, 1e9)) bad("time goes back")
+    last_ms = $1
+    count[$2]++
+}
+$2 == "frame" {
+    if (!empty(3, 10) || !number(11, 0, 65535) || !empty(12, 13)) bad("frame")
+    next
+}
+$2 == "overrun" {
+    if (!empty(3, 11) || !number(12, 1, 255) || $13 != "") bad("overrun")
+    next
+}
+$2 == "dropped" { bad("records were dropped") }
+# every other record is where the game is: spawn, lock, clear if any, score
+expect != "" && $2 != expect && !(expect == "clear" && $2 == "score") { bad("expected " expect) }
+$2 == "spawn" {
+    if (!number(3, 0, 6) || !number(4, 0, 6) || !empty(5, 13)) bad("spawn")
+    figure = $3
+    expect = "lock"
+    next
+}
+$2 == "lock" {
+    if (!number(3, 0, 6) || $4 != "" || !number(5, 0, width - 1) || !number(6, 0, height - 1) || !number(7, 0, 3) ||
+        !empty(8, 13))
+        bad("lock")
+    if ($3 != figure) bad("locked figure " $3 " was spawned as " figure)
+    lock_y = $6
+    lines = 0
+    expect = "clear"
+    next
+}
+$2 == "clear" {
+    if (!empty(3, 7) || !number(8, 1, 4) || !empty(10, 13)) bad("clear")
+    n = split($9, rows, " ")
+    if (n != $8) bad("lines and rows differ")
+    for (i = 1; i <= n; i++)
+        if (rows[i] !~ /^[0-9]+$/ || rows[i] < lock_y || rows[i] > lock_y + 3 || rows[i] >= height ||
+            (i > 1 && rows[i] <= rows[i - 1]))
+            bad("row " rows[i])
+    lines = n
+    expect = "score"
+    next
+}
+$2 == "score" {
+    if (!empty(3, 9) || !number(10, 0, 4294967295) || !empty(11, 13)) bad("score")
+    gained = 5 + 10 * lines
+    if ($10 != score + gained && $10 != gained) bad("score " $10 " after " score " and " lines " lines")
+    score = $10
+    expect = "spawn"
+    next
+}
+{ bad("unknown event") }
+END {
+    if (failed) exit 1
+    if (NR < 2) { print "FAIL telemetry: no records"; exit 1 }
+    printf "%d spawn, %d lock, %d clear, %d score, %d frame", count["spawn"], count["lock"], count["clear"],
+           count["score"], count["frame"] > "/dev/stderr"
+    if (!count["spawn"] || !count["lock"] || !count["clear"] || !count["score"] || !count["frame"])
+    {
+        print "FAIL telemetry: not every kind of record was seen"
+        exit 1
+    }
+    if (count["lock"] != count["score"]) { print "FAIL telemetry: a lock without a score"; exit 1 }
+}' "$dir/file.csv" 2> "$dir/summary" || { echo "telemetry_test: FAILED"; exit 1; }
+
+echo "telemetry_test: ok ($(cat "$dir/summary"))"
@@ -0,0 +1,255 @@
+/**
+ * Asset generator, runs on the host when the game is built.
+ * Reads the asset list and the upright PBM art it names and writes
+ * const tables already in the byte order the display is fed in,
+ * so nothing has to be rotated or packed at runtime.
+ *
+ * Usage: assetgen assets/assets.txt assets.c assets.h
+ *
+ * Every line of the asset list is one of
+ *   bitmap <name> <file.pbm>
+ *   font   <name> <file.pbm> <glyph width> <characters>
+ * Blank lines and lines starting with # are ignored.
+ *
+ * A bitmap becomes name[pages][height]: for every 8 pixel wide page,
+ * one byte per pixel row, bottom row first, leftmost pixel in bit 0.
+ * A font is a strip of glyphs of equal width, one per character.
+ * It becomes name[characters][height + 1] with the rows of each glyph
+ * in the same order followed by a byte covering every pixel the glyph
+ * uses, which is what the selection line under a letter is drawn with.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <ctype.h>
+
+#define LINE_MAX_LEN 256
+
+/**
+ * Upright 1-bit image, one byte per pixel
+ */
+struct image
+{
+    int w, h;
+    unsigned char *px;
+};
+
+static const char *list_path; // for error messages
+static int list_line;
+
+static void fail(const char *what, const char *arg)
+{
+    fprintf(stderr, "assetgen: %s:%d: %s %s\n", list_path, list_line, what, arg ? arg : "");
+    exit(1);
+}
+
+/**
+ * Reads the next number of a PBM header, skipping white space and comments
+ */
+static int pbm_number(FILE *f)
+{
+    int c, n = 0, digits = 0;
+
+    while ((c = fgetc(f)) != EOF)
+    {
+        if (c == '#')
+            while ((c = fgetc(f)) != EOF && c != '\n')
+                ;
+        else if (!isspace(c))
+            break;
+    }
+    while (c != EOF && isdigit(c))
+    {
+        n = n * 10 + c - '0';
+        digits++;
+        c = fgetc(f);
+    }
+    return digits ? n : -1;
+}
+
+/**
+ * Loads a plain (P1) PBM file, 1 is a lit pixel
+ */
+static void pbm_load(const char *path, struct image *img)
+{
+    FILE *f = fopen(path, "r");
+    int c, i = 0;
+
+    if (!f)
+        fail("cannot open", path);
+    if (fgetc(f) != 'P' || fgetc(f) != '1')
+        fail("not a plain PBM file:", path);
+
+    img->w = pbm_number(f);
+    img->h = pbm_number(f);
+    if (img->w <= 0 || img->h <= 0)
+        fail("bad PBM size in", path);
+
+    img->px = calloc(img->w * img->h, 1);
+    while (i < img->w * img->h && (c = fgetc(f)) != EOF)
+    {
+        if (c == '#')
+            while ((c = fgetc(f)) != EOF && c != '\n')
+                ;
+        else if (c == '0' || c == '1')
+            img->px[i++] = c == '1';
+    }
+    if (i < img->w * img->h)
+        fail("PBM file is short of pixels:", path);
+    fclose(f);
+}
+
+/**
+ * Packs 8 pixels of row y starting at column x, leftmost pixel in bit 0
+ */
+static unsigned pack(const struct image *img, int x, int y, int n)
+{
+    unsigned b = 0;
+    int i;
+
+    for (i = 0; i < n && x + i < img->w; i++)
+        b |= img->px[y * img->w + x + i] << i;
+    return b;
+}
+
+static void upper(char *dst, const char *src)
+{
+    while (*src)
+        *dst++ = toupper((unsigned char)*src++);
+    *dst = 0;
+}
+
+/**
+ * Writes a bitmap as name[pages][height], pixel rows bottom first
+ */
+static int emit_bitmap(FILE *c, FILE *h, const char *name, const struct image *img)
+{
+    int pages = (img->w + 7) / 8;
+    int p, y;
+    char up[LINE_MAX_LEN];
+
+    upper(up, name);
+    fprintf(h, "#define %s_PAGES %d\n#define %s_HEIGHT %d\n", up, pages, up, img->h);
+    fprintf(h, "extern const uint8_t %s[%s_PAGES][%s_HEIGHT];\n\n", name, up, up);
+
+    fprintf(c, "const uint8_t %s[%s_PAGES][%s_HEIGHT] = {\n", name, up, up);
+    for (p = 0; p < pages; p++)
+    {
+        fprintf(c, "    {");
+        for (y = img->h; y-- > 0;)
+            fprintf(c, "0x%02X%s", pack(img, p * 8, y, 8), y ? ", " : "");
+        fprintf(c, "}%s\n", p + 1 < pages ? "," : "");
+    }
+    fprintf(c, "};\n\n");
+    return pages * img->h;
+}
+
+/**
+ * Writes a font as name[glyphs][height + 1], glyph rows bottom first
+ */
+static int emit_font(FILE *c, FILE *h, const char *name, const struct image *img, int gw, const char *chars)
+{
+    int n = strlen(chars);
+    int g, y;
+    unsigned b, cover;
+    char up[LINE_MAX_LEN];
+
+    if (gw < 1 || gw > 8)
+        fail("glyph width must be 1 to 8 for", name);
+    if (n * gw > img->w)
+        fail("glyph strip is too narrow for", name);
+
+    upper(up, name);
+    fprintf(h, "#define %s_HEIGHT %d // glyph rows, followed by the glyph coverage\n", up, img->h);
+    fprintf(h, "#define %s_CHARS \"%s\"\n", up, chars);
+    fprintf(h, "extern const uint8_t %s[%d][%s_HEIGHT + 1];\n\n", name, n, up);
+
+    fprintf(c, "const uint8_t %s[%d][%s_HEIGHT + 1] = {\n", name, n, up);
+    for (g = 0; g < n; g++)
+    {
+        cover = 0;
+        fprintf(c, "    {");
+        for (y = img->h; y-- > 0;)
+        {
+            b = pack(img, g * gw, y, gw);
+            cover |= b;
+            fprintf(c, "0x%02X, ", b);
+        }
+        fprintf(c, "0x%02X}%s // %c\n", cover, g + 1 < n ? "," : "", chars[g]);
+    }
+    fprintf(c, "};\n\n");
+    return n * (img->h + 1);
+}
+
+int main(int argc, char **argv)
+{
+    FILE *list, *c, *h;
+    char line[LINE_MAX_LEN], kind[LINE_MAX_LEN], name[LINE_MAX_LEN], file[LINE_MAX_LEN];
+    char chars[LINE_MAX_LEN], path[2 * LINE_MAX_LEN], dir[LINE_MAX_LEN];
+    struct image img;
+    int gw, n, bytes, total = 0;
+    char *slash;
+
+    if (argc != 4)
+    {
+        fprintf(stderr, "usage: assetgen <asset list> <out.c> <out.h>\n");
+        return 1;
+    }
+
+    list_path = argv[1];
+    list = fopen(argv[1], "r");
+    if (!list)
+        fail("cannot open", argv[1]);
+
+    // art files are named relative to the asset list
+    strncpy(dir, argv[1], sizeof(dir) - 1);
+    dir[sizeof(dir) - 1] = 0;
+    slash = strrchr(dir, '/');
+    if (slash)
+        slash[1] = 0;
+    else
+        dir[0] = 0;
+
+    c = fopen(argv[2], "w");
+    h = fopen(argv[3], "w");
+    if (!c || !h)
+        fail("cannot write output", NULL);
+
+    fprintf(h, "/**\n * Generated by tools/assetgen from %s, do not edit\n */\n\n", argv[1]);
+    fprintf(c, "/**\n * Generated by tools/assetgen from %s, do not edit\n */\n", argv[1]);
+    fprintf(c, "#include <stdint.h>\n#include \"%s\"\n\n", argv[3]);
+
+    printf("asset            flash bytes\n");
+    while (fgets(line, sizeof(line), list))
+    {
+        list_line++;
+        n = sscanf(line, "%s %s %s %d %s", kind, name, file, &gw, chars);
+        if (n <= 0 || kind[0] == '#')
+            continue;
+
+        snprintf(path, sizeof(path), "%s%s", dir, file);
+        if (!strcmp(kind, "bitmap") && n == 3)
+        {
+            pbm_load(path, &img);
+            bytes = emit_bitmap(c, h, name, &img);
+        }
+        else if (!strcmp(kind, "font") && n == 5)
+        {
+            pbm_load(path, &img);
+            bytes = emit_font(c, h, name, &img, gw, chars);
+        }
+        else
+            fail("cannot parse:", line);
+
+        free(img.px);
+        printf("%-16s %11d\n", name, bytes);
+        total += bytes;
+    }
+    printf("%-16s %11d\n", "total", total);
+
+    fclose(list);
+    fclose(c);
+    fclose(h);
+    return 0;
+}
@@ -0,0 +1,182 @@
+/**
+ * Telemetry decoder, runs on the host.
+ * Reads the records a -DTELEMETRY build sends on UART1, from a serial
+ * port, a pty of the host build or a capture file, and writes one CSV
+ * line per record to stdout, ready for a spreadsheet or a plot.
+ *
+ * Usage: teledec [file]
+ * Reads stdin without a file. The columns are
+ *   time_ms,event,figure,next,x,y,rotation,lines,rows,score,us,ticks,dropped
+ * and every line only fills the ones its event has, rows lists the full
+ * rows of a clear separated by spaces. Text records, the reports a
+ * build with -DDISPLAY_STATS or -DPROFILE sends at game over, are not
+ * events and go to stderr as the lines they were sent as. Bytes that do
+ * not make a record, like a stream joined halfway through or bytes lost
+ * on the line, are skipped until the next record that checks out, and
+ * the skipped bytes are reported on stderr at the end.
+ * For copyright and licensing, see file COPYING
+ */
+#include <stdio.h>
+#include <stdint.h>
+#include "../telemetry.h"
+
+#define RECORD_MAX (4 + TELEMETRY_TEXT_CHARS) // mark and stamp, payload, checksum
+
+static const uint8_t payload_len[TELEMETRY_TYPES] = TELEMETRY_PAYLOAD;
+static const char *const names[TELEMETRY_TYPES] = {0, "spawn", "lock", "clear", "score", "frame", "overrun", "dropped", "text"};
+
+static uint8_t buf[RECORD_MAX];
+static int len;               // bytes in buf
+static unsigned long skipped; // bytes that were not part of a record
+static uint64_t frames;       // clock_frames of the last record, unwrapped
+static int seen;              // a record has been decoded
+
+/**
+ * Record length if buf starts with a mark and a known type, 0 if it does not
+ */
+static int record_len(void)
+{
+    uint8_t type = buf[0] & 0x0F;
+
+    if ((buf[0] & 0xF0) != TELEMETRY_MARK || !type || type >= TELEMETRY_TYPES)
+        return 0;
+    return 4 + payload_len[type];
+}
+
+static uint32_t word(const uint8_t *p, int n)
+{
+    uint32_t v = 0;
+
+    while (n--)
+        v = v << 8 | p[n];
+    return v;
+}
+
+static int bits(uint32_t v)
+{
+    int n = 0;
+
+    for (; v; v &= v - 1)
+        n++;
+    return n;
+}
+
+/**
+ * Writes the CSV line of the complete record in buf
+ */
+static void print_record(void)
+{
+    uint8_t type = buf[0] & 0x0F;
+    uint16_t stamp = word(buf + 1, 2);
+    const uint8_t *p = buf + 3;
+    const char *sep;
+    int i;
+
+    // stamps wrap every 65536 frames, about 4 minutes, records are never that far apart
+    if (seen)
+        frames += (uint16_t)(stamp - (uint16_t)frames);
+    else
+        frames = stamp;
+    seen = 1;
+
+    if (type == TELEMETRY_TEXT)
+    {
+        for (i = 0; i < TELEMETRY_TEXT_CHARS && p[i]; i++)
+            putc(p[i], stderr);
+        return;
+    }
+
+    printf("%.0f,%s,", (double)frames * TELEMETRY_US_PER_STAMP / 1000, names[type]);
+    switch (type)
+    {
+    case TELEMETRY_SPAWN:
+        printf("%d,%d,,,,,,,,,\n", p[0], p[1]);
+        break;
+    case TELEMETRY_LOCK:
+        printf("%d,,%d,%d,%d,,,,,,\n", p[0], p[1], p[2], p[3]);
+        break;
+    case TELEMETRY_CLEAR:
+        printf(",,,,,%d,", bits(p[1]));
+        for (i = 0, sep = ""; i < 8; i++)
+            if ((p[1] >> i) & 1)
+            {
+                printf("%s%d", sep, p[0] + i);
+                sep = " ";
+            }
+        printf(",,,,\n");
+        break;
+    case TELEMETRY_SCORE:
+        printf(",,,,,,,%u,,,\n", word(p, 4));
+        break;
+    case TELEMETRY_FRAME:
+        printf(",,,,,,,,%u,,\n", word(p, 2));
+        break;
+    case TELEMETRY_OVERRUN:
+        printf(",,,,,,,,,%d,\n", p[0]);
+        break;
+    case TELEMETRY_DROPPED:
+        printf(",,,,,,,,,,%u\n", word(p, 2));
+        break;
+    }
+    fflush(stdout); // a live stream is read as it comes
+}
+
+/**
+ * Takes one byte of the stream
+ */
+static void take(uint8_t b)
+{
+    int want, i;
+    uint8_t sum = 0;
+
+    buf[len++] = b;
+    while (len)
+    {
+        want = record_len();
+        if (!want)
+        { // not the start of a record, look for one in what follows
+            skipped++;
+            for (i = 1; i < len; i++)
+                buf[i - 1] = buf[i];
+            len--;
+            continue;
+        }
+        if (len < want)
+            return;
+
+        for (i = 0; i < want - 1; i++)
+            sum += buf[i];
+        if (sum == buf[want - 1])
+        {
+            print_record();
+            len = 0;
+            return;
+        }
+        buf[0] = 0; // a false start, drop its first byte and look again
+        sum = 0;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    FILE *f = stdin;
+    int c;
+
+    if (argc > 2)
+    {
+        fprintf(stderr, "usage: %s [file]\n", argv[0]);
+        return 1;
+    }
+    if (argc == 2 && !(f = fopen(argv[1], "rb")))
+    {
+        fprintf(stderr, "teledec: cannot open %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("time_ms,event,figure,next,x,y,rotation,lines,rows,score,us,ticks,dropped\n");
+    while ((c = getc(f)) != EOF)
+        take(c);
+    if (skipped)
+        fprintf(stderr, "teledec: skipped %lu bytes\n", skipped);
+    return 0;
+}